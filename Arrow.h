@@ -0,0 +1,298 @@
+#ifndef ARROW_H
+#define ARROW_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <exception>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+
+#include "QtySpan.h"
+#include "RuntimeUnit.h"
+#include "Units.h"
+
+/*
+ * The structures of the Arrow C data interface, as given by its
+ * specification so that they may be shared with other definitions
+ */
+#ifndef ARROW_C_DATA_INTERFACE
+#define ARROW_C_DATA_INTERFACE
+
+#define ARROW_FLAG_DICTIONARY_ORDERED 1
+#define ARROW_FLAG_NULLABLE 2
+#define ARROW_FLAG_MAP_KEYS_SORTED 4
+
+struct ArrowSchema {
+  const char *format;
+  const char *name;
+  const char *metadata;
+  int64_t flags;
+  int64_t n_children;
+  struct ArrowSchema **children;
+  struct ArrowSchema *dictionary;
+  void (*release)(struct ArrowSchema *);
+  void *private_data;
+};
+
+struct ArrowArray {
+  int64_t length;
+  int64_t null_count;
+  int64_t offset;
+  int64_t n_buffers;
+  int64_t n_children;
+  const void **buffers;
+  struct ArrowArray **children;
+  struct ArrowArray *dictionary;
+  void (*release)(struct ArrowArray *);
+  void *private_data;
+};
+
+#endif // ARROW_C_DATA_INTERFACE
+
+namespace phy {
+
+static_assert(sizeof(intmax_t) == sizeof(int64_t),
+              "quantities are exported as Arrow int64");
+
+namespace internal {
+
+struct ArrowSchemaData {
+  std::string name;
+  std::string metadata;
+};
+
+struct ArrowArrayData {
+  std::shared_ptr<const void> owner;
+  const void *buffers[2];
+};
+
+inline void releaseArrowSchema(ArrowSchema *schema) {
+  delete static_cast<ArrowSchemaData *>(schema->private_data);
+  schema->release = nullptr;
+}
+
+inline void releaseArrowArray(ArrowArray *array) {
+  delete static_cast<ArrowArrayData *>(array->private_data);
+  array->release = nullptr;
+}
+
+inline void appendInt32(std::string &out, int32_t value) {
+  out.append(reinterpret_cast<const char *>(&value), sizeof(value));
+}
+
+inline void appendMetadata(std::string &out, std::string_view key,
+                           std::string_view value) {
+  appendInt32(out, static_cast<int32_t>(key.size()));
+  out.append(key);
+  appendInt32(out, static_cast<int32_t>(value.size()));
+  out.append(value);
+}
+
+/*
+ * The value of key in the metadata of schema, which is a number of pairs
+ * followed by the length-prefixed keys and values
+ */
+inline bool findMetadata(const char *metadata, std::string_view key,
+                         std::string_view &value) {
+  if (metadata == nullptr) {
+    return false;
+  }
+  auto readInt32 = [&metadata]() {
+    int32_t res;
+    std::memcpy(&res, metadata, sizeof(res));
+    metadata += sizeof(res);
+    return res;
+  };
+  int32_t pairs = readInt32();
+  for (int32_t i = 0; i < pairs; ++i) {
+    int32_t keyLength = readInt32();
+    std::string_view currentKey(metadata, keyLength);
+    metadata += keyLength;
+    int32_t valueLength = readInt32();
+    if (currentKey == key) {
+      value = std::string_view(metadata, valueLength);
+      return true;
+    }
+    metadata += valueLength;
+  }
+  return false;
+}
+
+} // namespace internal
+
+/*
+ * The unit of an exported column, stored in the metadata of its field as
+ * "phy.exponents" = "1,0,-1,0,0,0,0,0" and "phy.ratio" = "1000/1"
+ */
+inline RuntimeUnit arrowUnit(const ArrowSchema &schema) {
+  std::string_view exponents, ratio;
+  if (!internal::findMetadata(schema.metadata, "phy.exponents", exponents) ||
+      !internal::findMetadata(schema.metadata, "phy.ratio", ratio)) {
+    throw std::runtime_error("Arrow: field without unit");
+  }
+
+  RuntimeUnit res{{}, 1, 1};
+  std::string text(exponents);
+  std::size_t pos = 0;
+  for (std::size_t i = 0; i < RuntimeUnit::Dimensions; ++i) {
+    std::size_t length = 0;
+    res.exponents[i] = std::stoi(text.substr(pos), &length);
+    pos += length + 1;
+  }
+  text = std::string(ratio);
+  std::size_t slash = text.find('/');
+  if (slash == std::string::npos) {
+    throw std::runtime_error("Arrow: invalid ratio " + text);
+  }
+  res.num = std::stoll(text.substr(0, slash));
+  res.den = std::stoll(text.substr(slash + 1));
+  return res;
+}
+
+/*
+ * Fills schema with an int64 field of quantities Q, released by its consumer
+ */
+template <class Q>
+void exportArrowSchema(ArrowSchema *schema, const std::string &name = "") {
+  using Quantity = typename std::remove_const<Q>::type;
+  RuntimeUnit unit = RuntimeUnit::of<typename Quantity::Unit,
+                                     typename Quantity::Ratio>();
+
+  std::string exponents;
+  for (std::size_t i = 0; i < RuntimeUnit::Dimensions; ++i) {
+    exponents += (i == 0 ? "" : ",") + std::to_string(unit.exponents[i]);
+  }
+  std::string ratio = std::to_string(unit.num) + "/" + std::to_string(unit.den);
+
+  auto data = new internal::ArrowSchemaData{name, std::string()};
+  internal::appendInt32(data->metadata, 2);
+  internal::appendMetadata(data->metadata, "phy.exponents", exponents);
+  internal::appendMetadata(data->metadata, "phy.ratio", ratio);
+
+  schema->format = "l";
+  schema->name = data->name.c_str();
+  schema->metadata = data->metadata.data();
+  schema->flags = 0;
+  schema->n_children = 0;
+  schema->children = nullptr;
+  schema->dictionary = nullptr;
+  schema->release = &internal::releaseArrowSchema;
+  schema->private_data = data;
+}
+
+/*
+ * Fills array with the values of column, without copying them. The column
+ * must outlive the array; the vector overload takes ownership instead.
+ */
+template <class Q> void exportArrowArray(QtySpan<Q> column, ArrowArray *array) {
+  auto data = new internal::ArrowArrayData{
+      nullptr, {nullptr, static_cast<const void *>(column.data())}};
+
+  array->length = column.size();
+  array->null_count = 0;
+  array->offset = 0;
+  array->n_buffers = 2;
+  array->n_children = 0;
+  array->buffers = data->buffers;
+  array->children = nullptr;
+  array->dictionary = nullptr;
+  array->release = &internal::releaseArrowArray;
+  array->private_data = data;
+}
+
+template <class Q>
+void exportArrowArray(QtyVector<Q> &&column, ArrowArray *array) {
+  auto owner = std::make_shared<const QtyVector<Q>>(std::move(column));
+  exportArrowArray(QtySpan<const Q>(*owner), array);
+  static_cast<internal::ArrowArrayData *>(array->private_data)->owner = owner;
+}
+
+/*
+ * A column of quantities Q imported from the Arrow C data interface.
+ * The import moves the array, whose values are then used in place until
+ * the column is destroyed, and releases the schema once it is checked.
+ */
+template <class Q> class ArrowColumn {
+public:
+  ArrowColumn(ArrowSchema *schema, ArrowArray *source) : array(*source) {
+    source->release = nullptr;
+    std::exception_ptr error;
+    try {
+      check(*schema);
+    } catch (...) {
+      error = std::current_exception();
+    }
+    if (schema->release != nullptr) {
+      schema->release(schema);
+    }
+    if (error) {
+      release();
+      std::rethrow_exception(error);
+    }
+  }
+
+  ArrowColumn(ArrowColumn &&other) noexcept : array(other.array) {
+    other.array.release = nullptr;
+  }
+
+  ArrowColumn(const ArrowColumn &) = delete;
+  ArrowColumn &operator=(const ArrowColumn &) = delete;
+  ArrowColumn &operator=(ArrowColumn &&) = delete;
+
+  ~ArrowColumn() { release(); }
+
+  QtySpan<const Q> span() const {
+    return QtySpan<const Q>(static_cast<const Q *>(array.buffers[1]) +
+                                array.offset,
+                            array.length);
+  }
+  std::size_t size() const { return array.length; }
+
+private:
+  void check(const ArrowSchema &schema) const {
+    if (std::strcmp(schema.format, "l") != 0 || array.n_buffers != 2) {
+      throw std::runtime_error("Arrow: array is not a column of int64");
+    }
+    if (hasNulls()) {
+      throw std::runtime_error("Arrow: array has null values");
+    }
+    if (arrowUnit(schema) !=
+        RuntimeUnit::of<typename Q::Unit, typename Q::Ratio>()) {
+      throw std::runtime_error("Arrow: array does not hold the quantity");
+    }
+  }
+
+  /*
+   * A null_count of -1 means "not computed": the validity bitmap, if any,
+   * is read to find out
+   */
+  bool hasNulls() const {
+    if (array.null_count >= 0 || array.buffers[0] == nullptr) {
+      return array.null_count > 0;
+    }
+    const uint8_t *validity = static_cast<const uint8_t *>(array.buffers[0]);
+    for (int64_t i = array.offset; i < array.offset + array.length; ++i) {
+      if ((validity[i / 8] & (1u << (i % 8))) == 0) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  void release() {
+    if (array.release != nullptr) {
+      array.release(&array);
+    }
+  }
+
+  ArrowArray array;
+};
+
+} // namespace phy
+
+#endif // ARROW_H
@@ -0,0 +1,99 @@
+#ifndef ATOMIC_QTY_H
+#define ATOMIC_QTY_H
+
+#include <atomic>
+#include <cstdint>
+#include <ratio>
+
+#include "Units.h"
+
+namespace phy {
+
+namespace internal {
+
+/*
+ * The value of q in the ratio R, the factor being folded at compile time.
+ * Only exact conversions (R divides ROther) are allowed, an accumulator must
+ * not silently drop what is below its resolution.
+ */
+template <typename R, typename U, typename ROther>
+constexpr intmax_t exactValue(Qty<U, ROther> q) {
+  using Factor = std::ratio_divide<ROther, R>;
+  static_assert(Factor::den == 1,
+                "the quantity is not representable in the target ratio");
+  return q.value * Factor::num;
+}
+
+} // namespace internal
+
+/*
+ * A quantity updated atomically, lock-free when std::atomic<intmax_t> is.
+ * The memory orderings are always explicit.
+ */
+template <class U, class R = std::ratio<1>> class AtomicQty {
+public:
+  using Quantity = Qty<U, R>;
+
+  static constexpr bool is_always_lock_free =
+      std::atomic<intmax_t>::is_always_lock_free;
+
+  AtomicQty() : value(0) {}
+  explicit AtomicQty(Quantity q) : value(q.value) {}
+
+  AtomicQty(const AtomicQty &) = delete;
+  AtomicQty &operator=(const AtomicQty &) = delete;
+
+  bool is_lock_free() const { return value.is_lock_free(); }
+
+  Quantity load(std::memory_order order) const {
+    return Quantity(value.load(order));
+  }
+
+  template <typename ROther>
+  void store(Qty<U, ROther> q, std::memory_order order) {
+    value.store(internal::exactValue<R>(q), order);
+  }
+
+  template <typename ROther>
+  Quantity exchange(Qty<U, ROther> q, std::memory_order order) {
+    return Quantity(value.exchange(internal::exactValue<R>(q), order));
+  }
+
+  template <typename ROther>
+  Quantity fetch_add(Qty<U, ROther> q, std::memory_order order) {
+    return Quantity(value.fetch_add(internal::exactValue<R>(q), order));
+  }
+
+  template <typename ROther>
+  Quantity fetch_sub(Qty<U, ROther> q, std::memory_order order) {
+    return Quantity(value.fetch_sub(internal::exactValue<R>(q), order));
+  }
+
+  /*
+   * On failure, expected is updated with the current value
+   */
+  template <typename ROther>
+  bool compare_exchange_weak(Quantity &expected, Qty<U, ROther> desired,
+                             std::memory_order success,
+                             std::memory_order failure) {
+    return value.compare_exchange_weak(expected.value,
+                                       internal::exactValue<R>(desired),
+                                       success, failure);
+  }
+
+  template <typename ROther>
+  bool compare_exchange_strong(Quantity &expected, Qty<U, ROther> desired,
+                               std::memory_order success,
+                               std::memory_order failure) {
+    return value.compare_exchange_strong(expected.value,
+                                         internal::exactValue<R>(desired),
+                                         success, failure);
+  }
+
+private:
+  std::atomic<intmax_t> value;
+};
+
+} // namespace phy
+
+#endif // ATOMIC_QTY_H
@@ -0,0 +1,141 @@
+#ifndef CALCULUS_H
+#define CALCULUS_H
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <ratio>
+#include <stdexcept>
+#include <type_traits>
+
+#include "QtySpan.h"
+#include "Units.h"
+
+namespace phy {
+
+/*
+ * The type of the integral of a Y column over a T column: the units and
+ * the ratios are multiplied, so that no precision is lost
+ */
+template <class T, class Y>
+using Integral =
+    Qty<MultiReturnUnit<typename QtySpan<Y>::Unit, typename QtySpan<T>::Unit>,
+        std::ratio_multiply<typename QtySpan<Y>::Ratio,
+                            typename QtySpan<T>::Ratio>>;
+
+/*
+ * The type of the derivative of a Y column over a T column
+ */
+template <class T, class Y>
+using Derivative =
+    Qty<DivideReturnUnit<typename QtySpan<Y>::Unit, typename QtySpan<T>::Unit>,
+        std::ratio_divide<typename QtySpan<Y>::Ratio,
+                          typename QtySpan<T>::Ratio>>;
+
+namespace internal {
+
+/*
+ * Checks that t is a strictly increasing column of times as long as y
+ */
+template <class T, class Y>
+void checkSampling(QtySpan<T> t, QtySpan<Y> y, std::size_t minimum) {
+  static_assert(std::is_same<typename QtySpan<T>::Unit, Second>::value,
+                "the sampling column must be a column of times");
+  if (t.size() != y.size()) {
+    throw std::invalid_argument("calculus: columns of different sizes");
+  }
+  if (t.size() < minimum) {
+    throw std::invalid_argument("calculus: not enough samples");
+  }
+  const intmax_t *times = t.values();
+  for (std::size_t i = 1; i < t.size(); ++i) {
+    if (times[i] <= times[i - 1]) {
+      throw std::invalid_argument("calculus: times not strictly increasing");
+    }
+  }
+}
+
+} // namespace internal
+
+/*
+ * The integral of y over the times t with the trapezoidal rule, for any
+ * sampling of t: the integral of a power over a time is an energy.
+ * The sum is exact on 128 bits and rounded to the nearest value once.
+ * Throws std::invalid_argument if the columns have different sizes or t
+ * is not strictly increasing, std::overflow_error if the result does not
+ * fit in the representation.
+ */
+template <class T, class Y>
+Integral<T, Y> integrate(QtySpan<T> t, QtySpan<Y> y) {
+  internal::checkSampling(t, y, 0);
+  const intmax_t *times = t.values();
+  const intmax_t *values = y.values();
+
+  __int128 twice = 0;
+  for (std::size_t i = 1; i < t.size(); ++i) {
+    twice += (static_cast<__int128>(values[i - 1]) + values[i]) *
+             (times[i] - times[i - 1]);
+  }
+  __int128 sum = (twice + ((twice < 0) ? -1 : 1)) / 2;
+  if (sum > INTMAX_MAX || sum < INTMAX_MIN) {
+    throw std::overflow_error("integrate: result out of range");
+  }
+  return Integral<T, Y>(static_cast<intmax_t>(sum));
+}
+
+/*
+ * The derivative of y over the times t, at each time of t: the derivative
+ * of a length is a speed, whose derivative is an acceleration.
+ *
+ * Inner points use the second order central difference for an irregular
+ * sampling, with h1 and h2 the steps before and after the point:
+ *   (h1^2 y[i+1] + (h2^2 - h1^2) y[i] - h2^2 y[i-1]) / (h1 h2 (h1 + h2))
+ * and the end points the one-sided difference. Result sets the ratio of
+ * the derivative, to keep digits that the ratio of Derivative would round.
+ * Throws std::invalid_argument if the columns have different sizes, less
+ * than 2 values or t is not strictly increasing.
+ */
+template <class Result, class T, class Y>
+QtyVector<Result> differentiate(QtySpan<T> t, QtySpan<Y> y) {
+  using Unit = typename Derivative<T, Y>::Unit;
+  static_assert(std::is_same<typename Result::Unit, Unit>::value,
+                "the result must have the unit of the derivative");
+  internal::checkSampling(t, y, 2);
+
+  /*
+   * From a value of Derivative to a value of Result
+   */
+  using Scale = std::ratio_divide<typename Derivative<T, Y>::Ratio,
+                                  typename Result::Ratio>;
+  const double scale = static_cast<double>(Scale::num) / Scale::den;
+
+  const intmax_t *times = t.values();
+  const intmax_t *values = y.values();
+  const std::size_t last = t.size() - 1;
+  QtyVector<Result> res(t.size(), Result(0));
+  intmax_t *out = QtySpan<Result>(res).values();
+
+  for (std::size_t i = 1; i < last; ++i) {
+    const double h1 = static_cast<double>(times[i] - times[i - 1]);
+    const double h2 = static_cast<double>(times[i + 1] - times[i]);
+    const double after = static_cast<double>(values[i + 1] - values[i]);
+    const double before = static_cast<double>(values[i] - values[i - 1]);
+    out[i] = std::llround((h1 * h1 * after + h2 * h2 * before) /
+                          (h1 * h2 * (h1 + h2)) * scale);
+  }
+  out[0] = std::llround(static_cast<double>(values[1] - values[0]) /
+                        (times[1] - times[0]) * scale);
+  out[last] =
+      std::llround(static_cast<double>(values[last] - values[last - 1]) /
+                   (times[last] - times[last - 1]) * scale);
+  return res;
+}
+
+template <class T, class Y>
+QtyVector<Derivative<T, Y>> differentiate(QtySpan<T> t, QtySpan<Y> y) {
+  return differentiate<Derivative<T, Y>>(t, y);
+}
+
+} // namespace phy
+
+#endif // CALCULUS_H
@@ -0,0 +1,133 @@
+#ifndef CHRONO_H
+#define CHRONO_H
+
+#include <chrono>
+#include <cstdint>
+#include <ratio>
+#include <type_traits>
+
+#include "Units.h"
+
+namespace phy {
+
+/*
+ * Implicit conversions between Qty<Second, R> and std::chrono durations.
+ * Like the conversions between durations, they only exist when they are
+ * exact (or towards a floating point rep), and the factor is folded at
+ * compile time.
+ */
+template <typename Rep, typename Period, typename R>
+struct QtyConverter<std::chrono::duration<Rep, Period>, Second, R> {
+  using Duration = std::chrono::duration<Rep, Period>;
+
+  static constexpr bool fromExact = std::is_integral<Rep>::value &&
+                                    std::ratio_divide<Period, R>::den == 1;
+
+  static constexpr bool toExact =
+      std::chrono::treat_as_floating_point<Rep>::value ||
+      std::ratio_divide<R, Period>::den == 1;
+
+  static constexpr intmax_t from(Duration d) {
+    return d.count() * std::ratio_divide<Period, R>::num;
+  }
+
+  static constexpr Duration to(intmax_t value) {
+    using Factor = std::ratio_divide<R, Period>;
+    return Duration(static_cast<Rep>(value) * Factor::num / Factor::den);
+  }
+};
+
+/*
+ * std::chrono::steady_clock, with the time since its epoch as a quantity
+ */
+struct SteadyClock {
+  static Qty<Second, std::nano> now() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch());
+  }
+};
+
+/*
+ * A time point of std::chrono::steady_clock, in the ratio R
+ */
+template <class R = std::nano> class SteadyTimePoint {
+public:
+  using Duration = Qty<Second, R>;
+  using ChronoTimePoint =
+      std::chrono::time_point<std::chrono::steady_clock,
+                              std::chrono::duration<intmax_t, R>>;
+
+  constexpr explicit SteadyTimePoint(Duration sinceEpoch) : since(sinceEpoch) {}
+
+  template <typename Dur>
+  constexpr SteadyTimePoint(
+      std::chrono::time_point<std::chrono::steady_clock, Dur> point)
+      : since(point.time_since_epoch()) {}
+
+  static SteadyTimePoint now() {
+    return SteadyTimePoint(
+        std::chrono::duration_cast<std::chrono::duration<intmax_t, R>>(
+            std::chrono::steady_clock::now().time_since_epoch()));
+  }
+
+  constexpr Duration timeSinceEpoch() const { return since; }
+
+  constexpr operator ChronoTimePoint() const {
+    return ChronoTimePoint(std::chrono::duration<intmax_t, R>(since));
+  }
+
+  /*
+   * The duration is rescaled exactly, like the std::chrono conversions
+   */
+  template <typename ROther>
+  constexpr SteadyTimePoint &operator+=(Qty<Second, ROther> d) {
+    since.value += std::chrono::duration<intmax_t, R>(
+                       std::chrono::duration<intmax_t, ROther>(d))
+                       .count();
+    return *this;
+  }
+
+  template <typename ROther>
+  constexpr SteadyTimePoint &operator-=(Qty<Second, ROther> d) {
+    since.value -= std::chrono::duration<intmax_t, R>(
+                       std::chrono::duration<intmax_t, ROther>(d))
+                       .count();
+    return *this;
+  }
+
+private:
+  Duration since;
+};
+
+template <typename R, typename ROther>
+constexpr SteadyTimePoint<R> operator+(SteadyTimePoint<R> point,
+                                       Qty<Second, ROther> d) {
+  return point += d;
+}
+
+template <typename R, typename ROther>
+constexpr SteadyTimePoint<R> operator-(SteadyTimePoint<R> point,
+                                       Qty<Second, ROther> d) {
+  return point -= d;
+}
+
+template <typename R>
+constexpr Qty<Second, R> operator-(SteadyTimePoint<R> p1,
+                                   SteadyTimePoint<R> p2) {
+  return Qty<Second, R>(p1.timeSinceEpoch().value -
+                        p2.timeSinceEpoch().value);
+}
+
+template <typename R>
+constexpr bool operator==(SteadyTimePoint<R> p1, SteadyTimePoint<R> p2) {
+  return p1.timeSinceEpoch().value == p2.timeSinceEpoch().value;
+}
+
+template <typename R>
+constexpr bool operator<(SteadyTimePoint<R> p1, SteadyTimePoint<R> p2) {
+  return p1.timeSinceEpoch().value < p2.timeSinceEpoch().value;
+}
+
+} // namespace phy
+
+#endif // CHRONO_H
@@ -0,0 +1,315 @@
+#ifndef CODEC_H
+#define CODEC_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+
+#include "ColumnFile.h"
+#include "QtySpan.h"
+#include "Units.h"
+
+namespace phy {
+
+/*
+ * DeltaOfDelta packs the zigzagged differences of the successive deltas,
+ * which suits timestamps and slowly varying values; Xor stores the
+ * meaningful bits of the exclusive or of successive values, as in Gorilla
+ */
+enum class Codec : uint8_t { DeltaOfDelta = 1, Xor = 2 };
+
+/*
+ * The header of a compressed block of at most BlockSize values, followed
+ * by size bytes of payload
+ */
+struct CodecBlockHeader {
+  static constexpr std::size_t BlockSize = 128;
+
+  ColumnSchema schema;
+  uint8_t codec;
+  uint8_t width; // of the packed values, for DeltaOfDelta
+  uint16_t count;
+  uint32_t size;
+  int64_t first;
+  int64_t delta; // between the first two values, for DeltaOfDelta
+  int64_t min;   // zone map of the block, in its unit and ratio
+  int64_t max;
+};
+
+static_assert(sizeof(CodecBlockHeader) == 72,
+              "CodecBlockHeader is an on-disk record");
+
+namespace internal {
+
+inline uint64_t zigzag(uint64_t value) {
+  return (value << 1) ^
+         static_cast<uint64_t>(static_cast<int64_t>(value) >> 63);
+}
+
+inline uint64_t unzigzag(uint64_t value) {
+  return (value >> 1) ^ (~(value & 1) + 1);
+}
+
+inline uint64_t lowBits(uint64_t value, unsigned width) {
+  return (width >= 64) ? value : value & ((UINT64_C(1) << width) - 1);
+}
+
+/*
+ * Appends bits to out in 64-bit little-endian words, least significant first
+ */
+class BitWriter {
+public:
+  explicit BitWriter(std::vector<uint8_t> &out) : out(out), word(0), used(0) {}
+
+  void write(uint64_t bits, unsigned width) {
+    if (width == 0) {
+      return;
+    }
+    bits = lowBits(bits, width);
+    word |= bits << used;
+    if (used + width >= 64) {
+      push();
+      word = (used == 0) ? 0 : bits >> (64 - used);
+      used = used + width - 64;
+    } else {
+      used += width;
+    }
+  }
+
+  void flush() {
+    if (used > 0) {
+      push();
+      word = 0;
+      used = 0;
+    }
+  }
+
+private:
+  void push() {
+    std::size_t size = out.size();
+    out.resize(size + sizeof(word));
+    std::memcpy(out.data() + size, &word, sizeof(word));
+  }
+
+  std::vector<uint8_t> &out;
+  uint64_t word;
+  unsigned used;
+};
+
+/*
+ * Reads the size bytes at data, throws std::runtime_error beyond them
+ */
+class BitReader {
+public:
+  BitReader(const uint8_t *data, std::size_t size)
+      : data(data), size(size), position(0) {}
+
+  uint64_t read(unsigned width) {
+    if (width == 0) {
+      return 0;
+    }
+    if (position + width > size * 8) {
+      throw std::runtime_error("decodeBlock: truncated block");
+    }
+    std::size_t index = position / 64;
+    unsigned offset = position % 64;
+    uint64_t res = load(index) >> offset;
+    if (offset + width > 64) {
+      res |= load(index + 1) << (64 - offset);
+    }
+    position += width;
+    return lowBits(res, width);
+  }
+
+private:
+  uint64_t load(std::size_t index) const {
+    uint64_t word = 0;
+    std::size_t begin = index * sizeof(word);
+    std::size_t bytes = (size - begin < sizeof(word)) ? size - begin
+                                                       : sizeof(word);
+    std::memcpy(&word, data + begin, bytes);
+    return word;
+  }
+
+  const uint8_t *data;
+  const std::size_t size;
+  std::size_t position;
+};
+
+inline unsigned bitWidth(uint64_t value) {
+  return (value == 0) ? 0 : 64 - __builtin_clzll(value);
+}
+
+inline void encodeBlock(const intmax_t *values, std::size_t count,
+                        const ColumnSchema &schema, Codec codec,
+                        std::vector<uint8_t> &out) {
+  CodecBlockHeader header{};
+  header.schema = schema;
+  header.codec = static_cast<uint8_t>(codec);
+  header.count = static_cast<uint16_t>(count);
+  header.first = values[0];
+  header.min = values[0];
+  header.max = values[0];
+  for (std::size_t i = 1; i < count; ++i) {
+    header.min = (values[i] < header.min) ? values[i] : header.min;
+    header.max = (values[i] > header.max) ? values[i] : header.max;
+  }
+
+  std::size_t headerOffset = out.size();
+  out.resize(headerOffset + sizeof(header));
+  BitWriter writer(out);
+
+  if (codec == Codec::DeltaOfDelta) {
+    /*
+     * The differences wrap around like the unsigned arithmetic of the decoder
+     */
+    uint64_t packed[CodecBlockHeader::BlockSize];
+    uint64_t delta = (count > 1) ? static_cast<uint64_t>(values[1]) -
+                                       static_cast<uint64_t>(values[0])
+                                 : 0;
+    uint64_t all = 0;
+    header.delta = static_cast<int64_t>(delta);
+    for (std::size_t i = 2; i < count; ++i) {
+      uint64_t current = static_cast<uint64_t>(values[i]) -
+                         static_cast<uint64_t>(values[i - 1]);
+      packed[i] = zigzag(current - delta);
+      all |= packed[i];
+      delta = current;
+    }
+    header.width = static_cast<uint8_t>(bitWidth(all));
+    for (std::size_t i = 2; i < count; ++i) {
+      writer.write(packed[i], header.width);
+    }
+  } else {
+    for (std::size_t i = 1; i < count; ++i) {
+      uint64_t x = static_cast<uint64_t>(values[i] ^ values[i - 1]);
+      if (x == 0) {
+        writer.write(0, 1);
+        continue;
+      }
+      unsigned leading = __builtin_clzll(x);
+      unsigned trailing = __builtin_ctzll(x);
+      unsigned length = 64 - leading - trailing;
+      writer.write(1, 1);
+      writer.write(leading, 6);
+      writer.write(length - 1, 6);
+      writer.write(x >> trailing, length);
+    }
+  }
+  writer.flush();
+
+  header.size =
+      static_cast<uint32_t>(out.size() - headerOffset - sizeof(header));
+  std::memcpy(out.data() + headerOffset, &header, sizeof(header));
+}
+
+/*
+ * The header of the block at data, followed by available bytes. Throws
+ * std::runtime_error unless the block is complete and holds between 1 and
+ * BlockSize values.
+ */
+inline CodecBlockHeader blockHeader(const uint8_t *data,
+                                    std::size_t available) {
+  CodecBlockHeader header;
+  if (available < sizeof(header)) {
+    throw std::runtime_error("compressed column: truncated block header");
+  }
+  std::memcpy(&header, data, sizeof(header));
+  if (header.count == 0 || header.count > CodecBlockHeader::BlockSize ||
+      header.width > 64 || header.size > available - sizeof(header)) {
+    throw std::runtime_error("compressed column: invalid block header");
+  }
+  return header;
+}
+
+/*
+ * Decodes the block at data, followed by available bytes, into out.
+ * Returns its header.
+ */
+inline CodecBlockHeader decodeBlock(const uint8_t *data,
+                                    std::size_t available, intmax_t *out) {
+  CodecBlockHeader header = blockHeader(data, available);
+  BitReader reader(data + sizeof(header), header.size);
+  std::size_t count = header.count;
+  out[0] = header.first;
+
+  if (header.codec == static_cast<uint8_t>(Codec::DeltaOfDelta)) {
+    uint64_t delta = static_cast<uint64_t>(header.delta);
+    uint64_t value = static_cast<uint64_t>(header.first) + delta;
+    if (count > 1) {
+      out[1] = static_cast<intmax_t>(value);
+    }
+    for (std::size_t i = 2; i < count; ++i) {
+      delta += unzigzag(reader.read(header.width));
+      value += delta;
+      out[i] = static_cast<intmax_t>(value);
+    }
+  } else if (header.codec == static_cast<uint8_t>(Codec::Xor)) {
+    uint64_t value = static_cast<uint64_t>(header.first);
+    for (std::size_t i = 1; i < count; ++i) {
+      if (reader.read(1) != 0) {
+        unsigned leading = static_cast<unsigned>(reader.read(6));
+        unsigned length = static_cast<unsigned>(reader.read(6)) + 1;
+        if (leading + length > 64) {
+          throw std::runtime_error("decodeBlock: invalid block");
+        }
+        value ^= reader.read(length) << (64 - leading - length);
+      }
+      out[i] = static_cast<intmax_t>(value);
+    }
+  } else {
+    throw std::runtime_error("decodeBlock: unknown codec");
+  }
+  return header;
+}
+
+} // namespace internal
+
+/*
+ * Compresses a column in blocks of CodecBlockHeader::BlockSize values,
+ * each block carrying the schema of the column
+ */
+template <class Q>
+std::vector<uint8_t> encodeColumn(QtySpan<Q> column, Codec codec) {
+  const ColumnSchema schema = ColumnSchema::of<Q>();
+  std::vector<uint8_t> res;
+  for (std::size_t i = 0; i < column.size();
+       i += CodecBlockHeader::BlockSize) {
+    std::size_t count = column.size() - i;
+    count = (count < CodecBlockHeader::BlockSize) ? count
+                                                  : CodecBlockHeader::BlockSize;
+    internal::encodeBlock(column.values() + i, count, schema, codec, res);
+  }
+  return res;
+}
+
+/*
+ * Decompresses a column of quantities Q, whose blocks must hold exactly Q.
+ * Throws std::runtime_error if the data is not a valid compressed column.
+ */
+template <class Q>
+std::vector<Q> decodeColumn(const std::vector<uint8_t> &data) {
+  const ColumnSchema schema = ColumnSchema::of<Q>();
+  intmax_t block[CodecBlockHeader::BlockSize];
+  std::vector<Q> res;
+  std::size_t offset = 0;
+  while (offset < data.size()) {
+    CodecBlockHeader header = internal::decodeBlock(
+        data.data() + offset, data.size() - offset, block);
+    if (header.schema != schema) {
+      throw std::runtime_error(
+          "decodeColumn: block does not hold the quantity");
+    }
+    for (std::size_t i = 0; i < header.count; ++i) {
+      res.push_back(Q(block[i]));
+    }
+    offset += sizeof(header) + header.size;
+  }
+  return res;
+}
+
+} // namespace phy
+
+#endif // CODEC_H
@@ -0,0 +1,196 @@
+#ifndef COLUMN_FILE_H
+#define COLUMN_FILE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "MappedFile.h"
+#include "QtySpan.h"
+#include "RuntimeUnit.h"
+#include "Units.h"
+
+namespace phy {
+
+/*
+ * The on-disk description of a column of quantities: the exponents of the
+ * unit, the ratio and the representation of the values
+ */
+struct ColumnSchema {
+  int8_t exponents[RuntimeUnit::Dimensions];
+  int64_t num;
+  int64_t den;
+  uint8_t repType; // 'i' for a signed integer
+  uint8_t repSize;
+  uint8_t reserved[6];
+
+  template <class Q> static ColumnSchema of() {
+    using Quantity = typename std::remove_const<Q>::type;
+    return fromUnit(RuntimeUnit::of<typename Quantity::Unit,
+                                    typename Quantity::Ratio>());
+  }
+
+  static ColumnSchema fromUnit(const RuntimeUnit &unit) {
+    ColumnSchema res{};
+    for (std::size_t i = 0; i < RuntimeUnit::Dimensions; ++i) {
+      res.exponents[i] = static_cast<int8_t>(unit.exponents[i]);
+    }
+    res.num = unit.num;
+    res.den = unit.den;
+    res.repType = 'i';
+    res.repSize = sizeof(intmax_t);
+    return res;
+  }
+
+  RuntimeUnit unit() const {
+    RuntimeUnit res{{}, num, den};
+    for (std::size_t i = 0; i < RuntimeUnit::Dimensions; ++i) {
+      res.exponents[i] = exponents[i];
+    }
+    return res;
+  }
+
+  bool operator==(const ColumnSchema &other) const {
+    return unit() == other.unit() && repType == other.repType &&
+           repSize == other.repSize;
+  }
+  bool operator!=(const ColumnSchema &other) const { return !(*this == other); }
+};
+
+static_assert(sizeof(ColumnSchema) == 32, "ColumnSchema is an on-disk record");
+
+/*
+ * The header of a column file, followed by the values at dataOffset
+ */
+struct ColumnHeader {
+  static constexpr uint32_t Version = 1;
+  static constexpr std::size_t Alignment = 64;
+
+  char magic[4];
+  uint32_t version;
+  uint64_t count;
+  uint64_t dataOffset;
+  uint64_t reserved;
+  ColumnSchema schema;
+
+  bool valid() const {
+    return std::memcmp(magic, "PHYQ", 4) == 0 && version == Version;
+  }
+};
+
+static_assert(sizeof(ColumnHeader) == ColumnHeader::Alignment,
+              "ColumnHeader is an on-disk record");
+
+/*
+ * Writes a column of quantities with its schema
+ */
+template <class Q>
+void writeColumn(const std::string &path, QtySpan<Q> column) {
+  ColumnHeader header{};
+  std::memcpy(header.magic, "PHYQ", 4);
+  header.version = ColumnHeader::Version;
+  header.count = column.size();
+  header.dataOffset = ColumnHeader::Alignment;
+  header.schema = ColumnSchema::of<Q>();
+
+  std::ofstream out(path, std::ios::binary | std::ios::trunc);
+  out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+  out.write(reinterpret_cast<const char *>(column.values()),
+            column.size() * sizeof(intmax_t));
+  if (!out) {
+    throw std::runtime_error("writeColumn: cannot write " + path);
+  }
+}
+
+namespace internal {
+
+/*
+ * The header of a column file, whose values are checked to lie within the
+ * file without computing their end, which a forged count would overflow
+ */
+inline const ColumnHeader &columnHeader(const MappedFile &file,
+                                        const std::string &path) {
+  if (file.size() < sizeof(ColumnHeader)) {
+    throw std::runtime_error("column file: " + path + " is truncated");
+  }
+  const ColumnHeader &header =
+      *reinterpret_cast<const ColumnHeader *>(file.data());
+  if (!header.valid() || header.dataOffset % ColumnHeader::Alignment != 0 ||
+      header.dataOffset > file.size() ||
+      header.count > (file.size() - header.dataOffset) / sizeof(intmax_t) ||
+      header.schema.num <= 0 || header.schema.den <= 0) {
+    throw std::runtime_error("column file: " + path + " is invalid");
+  }
+  return header;
+}
+
+} // namespace internal
+
+/*
+ * A column file mapped in memory, whose values are used in place.
+ * Opening fails unless the file holds exactly quantities of type Q.
+ */
+template <class Q> class MappedColumn {
+public:
+  explicit MappedColumn(const std::string &path) : file(path) {
+    const ColumnHeader &header = internal::columnHeader(file, path);
+    if (header.schema != ColumnSchema::of<Q>()) {
+      throw std::runtime_error("MappedColumn: " + path +
+                               " does not hold the requested quantity");
+    }
+    values = QtySpan<const Q>(
+        reinterpret_cast<const Q *>(file.data() + header.dataOffset),
+        header.count);
+  }
+
+  QtySpan<const Q> span() const { return values; }
+  std::size_t size() const { return values.size(); }
+
+private:
+  MappedFile file;
+  QtySpan<const Q> values;
+};
+
+/*
+ * Reads a column file holding quantities with the dimension of Q in any
+ * ratio, converted in a single pass. Throws std::out_of_range if a value
+ * does not fit in the ratio of Q.
+ */
+template <class Q> std::vector<Q> readColumn(const std::string &path) {
+  MappedFile file(path);
+  const ColumnHeader &header = internal::columnHeader(file, path);
+  RuntimeUnit stored = header.schema.unit();
+  RuntimeUnit expected =
+      RuntimeUnit::of<typename Q::Unit, typename Q::Ratio>();
+  if (!stored.sameDimension(expected) || header.schema.repType != 'i' ||
+      header.schema.repSize != sizeof(intmax_t)) {
+    throw std::runtime_error("readColumn: " + path +
+                             " does not hold the requested dimension");
+  }
+
+  internal::combine(stored, expected, -1);
+  const intmax_t num = stored.num;
+  const intmax_t den = stored.den;
+  const intmax_t *values =
+      reinterpret_cast<const intmax_t *>(file.data() + header.dataOffset);
+
+  std::vector<Q> res;
+  res.reserve(header.count);
+  for (std::size_t i = 0; i < header.count; ++i) {
+    __int128 value = static_cast<__int128>(values[i]) * num / den;
+    if (value > INTMAX_MAX || value < INTMAX_MIN) {
+      throw std::out_of_range("readColumn: value out of range in " + path);
+    }
+    res.push_back(Q(static_cast<intmax_t>(value)));
+  }
+  return res;
+}
+
+} // namespace phy
+
+#endif // COLUMN_FILE_H
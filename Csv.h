@@ -0,0 +1,359 @@
+#ifndef CSV_H
+#define CSV_H
+
+#include <charconv>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "MappedFile.h"
+#include "RuntimeUnit.h"
+#include "Units.h"
+
+namespace phy {
+
+/*
+ * A column read without knowing its unit at compile time,
+ * the values are expressed in the unit of the header
+ */
+struct CsvColumn {
+  std::string name;
+  RuntimeUnit unit;
+  std::vector<double> values;
+};
+
+namespace internal {
+
+/*
+ * The first ',' or '\n' of [p, end), 16 bytes at a time
+ */
+inline const char *findDelimiter(const char *p, const char *end) {
+#if defined(__SSE2__)
+  const __m128i comma = _mm_set1_epi8(',');
+  const __m128i newline = _mm_set1_epi8('\n');
+  for (; p + 16 <= end; p += 16) {
+    __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+    int mask = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(chunk, comma),
+                                              _mm_cmpeq_epi8(chunk, newline)));
+    if (mask != 0) {
+      return p + __builtin_ctz(mask);
+    }
+  }
+#endif
+  while (p < end && *p != ',' && *p != '\n') {
+    ++p;
+  }
+  return p;
+}
+
+inline std::string_view trimField(std::string_view field) {
+  while (!field.empty() && (field.front() == ' ' || field.front() == '\t')) {
+    field.remove_prefix(1);
+  }
+  while (!field.empty() && (field.back() == ' ' || field.back() == '\t' ||
+                            field.back() == '\r')) {
+    field.remove_suffix(1);
+  }
+  return field;
+}
+
+/*
+ * The exact value of the decimal number times num / den, truncated like
+ * qtyCast
+ */
+inline intmax_t parseScaled(std::string_view field, intmax_t num,
+                            intmax_t den) {
+  std::size_t pos = 0;
+  bool negative = false;
+  if (pos < field.size() && (field[pos] == '-' || field[pos] == '+')) {
+    negative = field[pos] == '-';
+    ++pos;
+  }
+
+  __int128 mantissa = 0;
+  int digits = 0;
+  int exponent = 0;
+  bool point = false;
+  for (; pos < field.size(); ++pos) {
+    char c = field[pos];
+    if (c >= '0' && c <= '9') {
+      if (++digits > 36) {
+        throw std::runtime_error("parseScaled: too many digits");
+      }
+      mantissa = mantissa * 10 + (c - '0');
+      exponent -= point;
+    } else if (c == '.' && !point) {
+      point = true;
+    } else {
+      break;
+    }
+  }
+  if (pos < field.size() && (field[pos] == 'e' || field[pos] == 'E')) {
+    int value = 0;
+    auto res = std::from_chars(field.data() + pos + 1,
+                               field.data() + field.size(), value);
+    if (res.ec != std::errc() || res.ptr != field.data() + field.size()) {
+      throw std::runtime_error("parseScaled: invalid number '" +
+                               std::string(field) + "'");
+    }
+    exponent += value;
+    pos = field.size();
+  }
+  if (digits == 0 || pos != field.size() || exponent > 30 || exponent < -30) {
+    throw std::runtime_error("parseScaled: invalid number '" +
+                             std::string(field) + "'");
+  }
+
+  /*
+   * The multiplications are checked, the divisions come last and one at a
+   * time: floor(floor(a / b) / c) == floor(a / (b * c))
+   */
+  __int128 res;
+  if (__builtin_mul_overflow(mantissa, static_cast<__int128>(num), &res)) {
+    throw std::out_of_range("parseScaled: value out of range");
+  }
+  for (; exponent > 0; --exponent) {
+    if (__builtin_mul_overflow(res, static_cast<__int128>(10), &res)) {
+      throw std::out_of_range("parseScaled: value out of range");
+    }
+  }
+  res /= den;
+  for (; exponent < 0; ++exponent) {
+    res /= 10;
+  }
+  if (res > INTMAX_MAX) {
+    throw std::out_of_range("parseScaled: value out of range");
+  }
+  return static_cast<intmax_t>(negative ? -res : res);
+}
+
+struct CsvHeader {
+  std::vector<std::string> names;
+  std::vector<RuntimeUnit> units;
+  const char *body;
+};
+
+/*
+ * "distance[km],duration[ms]", a column without unit is dimensionless
+ */
+inline CsvHeader parseCsvHeader(const char *begin, const char *end) {
+  if (begin == end) {
+    throw std::runtime_error("readCsv: missing header");
+  }
+  CsvHeader header;
+  const char *p = begin;
+  for (;;) {
+    const char *delimiter = findDelimiter(p, end);
+    std::string_view field = trimField(std::string_view(p, delimiter - p));
+    if (field.empty()) {
+      throw std::runtime_error("readCsv: empty column name");
+    }
+
+    std::size_t open = field.find('[');
+    if (open != std::string_view::npos && field.back() == ']') {
+      header.names.emplace_back(trimField(field.substr(0, open)));
+      header.units.push_back(
+          parseUnit(field.substr(open + 1, field.size() - open - 2)));
+    } else {
+      header.names.emplace_back(field);
+      header.units.push_back(RuntimeUnit{{}, 1, 1});
+    }
+
+    if (delimiter == end || *delimiter == '\n') {
+      header.body = (delimiter == end) ? end : delimiter + 1;
+      return header;
+    }
+    p = delimiter + 1;
+  }
+}
+
+/*
+ * Parses the rows of [begin, end) with convert(column, field), the data
+ * being split in newline-aligned chunks parsed by different threads.
+ * With threads = 0, there is one thread per MiB up to the number of cores.
+ */
+template <class T, class Convert>
+std::vector<std::vector<T>> parseCsvRows(const char *begin, const char *end,
+                                         std::size_t columns, unsigned threads,
+                                         Convert convert) {
+  const std::size_t minChunk = 1 << 20;
+  std::size_t size = end - begin;
+  std::size_t chunks = threads;
+  if (threads == 0) {
+    std::size_t hardware = std::thread::hardware_concurrency();
+    chunks = size / minChunk + 1;
+    chunks = (chunks < hardware) ? chunks : hardware;
+    chunks = (chunks == 0) ? 1 : chunks;
+  }
+
+  std::vector<const char *> bounds{begin};
+  for (std::size_t i = 1; i < chunks; ++i) {
+    const char *p = begin + size * i / chunks;
+    p = (p < bounds.back()) ? bounds.back() : p;
+    while (p < end && *p != '\n') {
+      ++p;
+    }
+    bounds.push_back(p < end ? p + 1 : end);
+  }
+  bounds.push_back(end);
+
+  std::vector<std::vector<std::vector<T>>> results(
+      chunks, std::vector<std::vector<T>>(columns));
+  std::vector<std::exception_ptr> errors(chunks);
+
+  auto parse = [&](std::size_t chunk) {
+    try {
+      const char *p = bounds[chunk];
+      const char *last = bounds[chunk + 1];
+      auto &out = results[chunk];
+      while (p < last) {
+        if (*p == '\n' || *p == '\r') {
+          ++p;
+          continue;
+        }
+        for (std::size_t column = 0; column < columns; ++column) {
+          const char *delimiter = findDelimiter(p, last);
+          bool endOfRow = (delimiter == last || *delimiter == '\n');
+          if (endOfRow != (column + 1 == columns)) {
+            throw std::runtime_error("readCsv: wrong number of fields");
+          }
+          out[column].push_back(
+              convert(column, trimField(std::string_view(p, delimiter - p))));
+          p = delimiter + 1;
+        }
+      }
+    } catch (...) {
+      errors[chunk] = std::current_exception();
+    }
+  };
+
+  std::vector<std::thread> workers;
+  for (std::size_t chunk = 1; chunk < chunks; ++chunk) {
+    workers.emplace_back(parse, chunk);
+  }
+  parse(0);
+  for (auto &worker : workers) {
+    worker.join();
+  }
+  for (auto &error : errors) {
+    if (error) {
+      std::rethrow_exception(error);
+    }
+  }
+
+  std::vector<std::vector<T>> res = std::move(results[0]);
+  for (std::size_t chunk = 1; chunk < chunks; ++chunk) {
+    for (std::size_t column = 0; column < columns; ++column) {
+      res[column].insert(res[column].end(), results[chunk][column].begin(),
+                         results[chunk][column].end());
+    }
+  }
+  return res;
+}
+
+template <class Q> std::vector<Q> toQuantities(const std::vector<intmax_t> &raw) {
+  std::vector<Q> res;
+  res.reserve(raw.size());
+  for (intmax_t value : raw) {
+    res.push_back(Q(value));
+  }
+  return res;
+}
+
+template <class... Qs, std::size_t... Is>
+std::tuple<std::vector<Qs>...>
+toColumns(const std::vector<std::vector<intmax_t>> &raw,
+          std::index_sequence<Is...>) {
+  return std::tuple<std::vector<Qs>...>(toQuantities<Qs>(raw[Is])...);
+}
+
+} // namespace internal
+
+/*
+ * Reads a CSV file whose header gives the unit of each column, for
+ * example "distance[km],duration[ms]", into columns of the quantities Qs.
+ * The units must have the dimensions of Qs, the values are converted
+ * directly into the ratios of Qs.
+ */
+template <class... Qs>
+std::tuple<std::vector<Qs>...> readCsv(const std::string &path,
+                                       unsigned threads = 0) {
+  MappedFile file(path);
+  file.adviseSequential();
+  const char *end = file.data() + file.size();
+  internal::CsvHeader header = internal::parseCsvHeader(file.data(), end);
+
+  const RuntimeUnit expected[] = {
+      RuntimeUnit::of<typename Qs::Unit, typename Qs::Ratio>()...};
+  if (header.units.size() != sizeof...(Qs)) {
+    throw std::runtime_error("readCsv: wrong number of columns in " + path);
+  }
+
+  /*
+   * The conversion factor of each column, from its unit to its quantity
+   */
+  std::vector<std::pair<intmax_t, intmax_t>> factors;
+  for (std::size_t i = 0; i < sizeof...(Qs); ++i) {
+    if (!header.units[i].sameDimension(expected[i])) {
+      throw std::runtime_error("readCsv: column " + header.names[i] +
+                               " does not have the expected dimension");
+    }
+    RuntimeUnit factor = header.units[i];
+    internal::combine(factor, expected[i], -1);
+    factors.emplace_back(factor.num, factor.den);
+  }
+
+  auto raw = internal::parseCsvRows<intmax_t>(
+      header.body, end, sizeof...(Qs), threads,
+      [&factors](std::size_t column, std::string_view field) {
+        return internal::parseScaled(field, factors[column].first,
+                                     factors[column].second);
+      });
+  return internal::toColumns<Qs...>(raw, std::index_sequence_for<Qs...>());
+}
+
+/*
+ * Reads a CSV file with units in its header into runtime-dimensioned columns
+ */
+inline std::vector<CsvColumn> readCsvColumns(const std::string &path,
+                                             unsigned threads = 0) {
+  MappedFile file(path);
+  file.adviseSequential();
+  const char *end = file.data() + file.size();
+  internal::CsvHeader header = internal::parseCsvHeader(file.data(), end);
+
+  auto values = internal::parseCsvRows<double>(
+      header.body, end, header.units.size(), threads,
+      [](std::size_t, std::string_view field) {
+        double value = 0.0;
+        auto res = std::from_chars(field.data(), field.data() + field.size(),
+                                   value);
+        if (res.ec != std::errc() || res.ptr != field.data() + field.size()) {
+          throw std::runtime_error("readCsv: invalid number '" +
+                                   std::string(field) + "'");
+        }
+        return value;
+      });
+
+  std::vector<CsvColumn> res;
+  for (std::size_t i = 0; i < header.units.size(); ++i) {
+    res.push_back(
+        CsvColumn{header.names[i], header.units[i], std::move(values[i])});
+  }
+  return res;
+}
+
+} // namespace phy
+
+#endif // CSV_H
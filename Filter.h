@@ -0,0 +1,193 @@
+#ifndef FILTER_H
+#define FILTER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <type_traits>
+#include <vector>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+#include "QtySpan.h"
+#include "Units.h"
+
+namespace phy {
+
+/*
+ * A selection bitmap: bit i is set when the row i matched the predicate
+ */
+class Bitmap {
+public:
+  explicit Bitmap(std::size_t size) : words((size + 63) / 64, 0), bits(size) {}
+
+  std::size_t size() const { return bits; }
+
+  bool test(std::size_t i) const { return (words[i / 64] >> (i % 64)) & 1; }
+
+  std::size_t count() const {
+    std::size_t res = 0;
+    for (uint64_t word : words) {
+      res += __builtin_popcountll(word);
+    }
+    return res;
+  }
+
+  /*
+   * The selection vector: indices of the set bits, in increasing order
+   */
+  std::vector<std::size_t> indices() const {
+    std::vector<std::size_t> res;
+    res.reserve(count());
+    for (std::size_t w = 0; w < words.size(); ++w) {
+      for (uint64_t word = words[w]; word != 0; word &= word - 1) {
+        res.push_back(w * 64 + __builtin_ctzll(word));
+      }
+    }
+    return res;
+  }
+
+  uint64_t *data() { return words.data(); }
+  const uint64_t *data() const { return words.data(); }
+
+private:
+  std::vector<uint64_t> words;
+  std::size_t bits;
+};
+
+namespace internal {
+
+/*
+ * Sets the bit of every value in [min, max], 64 values per bitmap word
+ */
+inline void scanRange(const intmax_t *values, std::size_t size, intmax_t min,
+                      intmax_t max, uint64_t *words) {
+  std::size_t i = 0;
+
+#if defined(__AVX2__)
+  const __m256i vmin = _mm256_set1_epi64x(min);
+  const __m256i vmax = _mm256_set1_epi64x(max);
+
+  for (; i + 64 <= size; i += 64) {
+    uint64_t word = 0;
+    for (std::size_t j = 0; j < 64; j += 4) {
+      __m256i v = _mm256_loadu_si256(
+          reinterpret_cast<const __m256i *>(values + i + j));
+      __m256i out = _mm256_or_si256(_mm256_cmpgt_epi64(vmin, v),
+                                    _mm256_cmpgt_epi64(v, vmax));
+      uint64_t mask = _mm256_movemask_pd(_mm256_castsi256_pd(out));
+      word |= (~mask & 0xF) << j;
+    }
+    words[i / 64] = word;
+  }
+#endif
+
+  for (; i < size; i += 64) {
+    std::size_t end = (size - i < 64) ? size - i : 64;
+    uint64_t word = 0;
+    for (std::size_t j = 0; j < end; ++j) {
+      intmax_t v = values[i + j];
+      word |= static_cast<uint64_t>((v >= min) & (v <= max)) << j;
+    }
+    words[i / 64] = word;
+  }
+}
+
+template <typename Q>
+Bitmap selectRange(QtySpan<Q> column, intmax_t min, intmax_t max) {
+  Bitmap res(column.size());
+  if (min <= max) {
+    scanRange(column.values(), column.size(), min, max, res.data());
+  }
+  return res;
+}
+
+} // namespace internal
+
+/*
+ * Comparison kernels against a threshold given in any ratio.
+ * The threshold is converted once into a bound in the ratio of the column,
+ * then the raw values are compared without any cast.
+ */
+
+template <typename Q, typename U, typename R>
+Bitmap selectLess(QtySpan<Q> column, Qty<U, R> threshold) {
+  using Column = typename QtySpan<Q>::Quantity;
+  static_assert(std::is_same<typename Column::Unit, U>::value,
+                "the threshold must have the unit of the column");
+
+  intmax_t bound = qtyCeilCast<Column>(threshold).value;
+  if (bound == std::numeric_limits<intmax_t>::min()) {
+    return Bitmap(column.size());
+  }
+  return internal::selectRange(column, std::numeric_limits<intmax_t>::min(),
+                               bound - 1);
+}
+
+template <typename Q, typename U, typename R>
+Bitmap selectLessEqual(QtySpan<Q> column, Qty<U, R> threshold) {
+  using Column = typename QtySpan<Q>::Quantity;
+  static_assert(std::is_same<typename Column::Unit, U>::value,
+                "the threshold must have the unit of the column");
+
+  intmax_t bound = qtyFloorCast<Column>(threshold).value;
+  return internal::selectRange(column, std::numeric_limits<intmax_t>::min(),
+                               bound);
+}
+
+template <typename Q, typename U, typename R>
+Bitmap selectGreater(QtySpan<Q> column, Qty<U, R> threshold) {
+  using Column = typename QtySpan<Q>::Quantity;
+  static_assert(std::is_same<typename Column::Unit, U>::value,
+                "the threshold must have the unit of the column");
+
+  intmax_t bound = qtyFloorCast<Column>(threshold).value;
+  if (bound == std::numeric_limits<intmax_t>::max()) {
+    return Bitmap(column.size());
+  }
+  return internal::selectRange(column, bound + 1,
+                               std::numeric_limits<intmax_t>::max());
+}
+
+template <typename Q, typename U, typename R>
+Bitmap selectGreaterEqual(QtySpan<Q> column, Qty<U, R> threshold) {
+  using Column = typename QtySpan<Q>::Quantity;
+  static_assert(std::is_same<typename Column::Unit, U>::value,
+                "the threshold must have the unit of the column");
+
+  intmax_t bound = qtyCeilCast<Column>(threshold).value;
+  return internal::selectRange(column, bound,
+                               std::numeric_limits<intmax_t>::max());
+}
+
+/*
+ * Selects the values in [lo, hi)
+ */
+template <typename Q, typename U, typename RLo, typename RHi>
+Bitmap selectBetween(QtySpan<Q> column, Qty<U, RLo> lo, Qty<U, RHi> hi) {
+  using Column = typename QtySpan<Q>::Quantity;
+  static_assert(std::is_same<typename Column::Unit, U>::value,
+                "the bounds must have the unit of the column");
+
+  intmax_t min = qtyCeilCast<Column>(lo).value;
+  intmax_t bound = qtyCeilCast<Column>(hi).value;
+  if (bound == std::numeric_limits<intmax_t>::min()) {
+    return Bitmap(column.size());
+  }
+  return internal::selectRange(column, min, bound - 1);
+}
+
+/*
+ * Indices of the values in [lo, hi)
+ */
+template <typename Q, typename U, typename RLo, typename RHi>
+std::vector<std::size_t> where(QtySpan<Q> column, Qty<U, RLo> lo,
+                               Qty<U, RHi> hi) {
+  return selectBetween(column, lo, hi).indices();
+}
+
+} // namespace phy
+
+#endif // FILTER_H
@@ -0,0 +1,149 @@
+#ifndef HDR_HISTOGRAM_H
+#define HDR_HISTOGRAM_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <ratio>
+#include <stdexcept>
+#include <vector>
+
+#include "Units.h"
+
+namespace phy {
+
+/*
+ * High dynamic range histogram: the values are counted in log-linear buckets,
+ * 2^Precision linear buckets below 2^Precision then 2^(Precision-1) buckets
+ * per power of two, so the relative error is bounded by 2^-(Precision-1).
+ * Recording is a lock-free increment, without allocation.
+ */
+template <class Q, int Precision = 7> class HdrHistogram;
+
+namespace internal {
+
+template <int Precision> struct HdrLayout {
+  static_assert(Precision >= 1 && Precision <= 16, "unsupported precision");
+
+  static constexpr uint64_t Half = UINT64_C(1) << (Precision - 1);
+  static constexpr std::size_t Buckets = (66 - Precision) * Half;
+
+  static std::size_t index(uint64_t value) {
+    int msb = 63 - __builtin_clzll(value | 1);
+    int shift = (msb >= Precision) ? msb - Precision + 1 : 0;
+    return shift * Half + (value >> shift);
+  }
+
+  /*
+   * The highest value counted in the bucket
+   */
+  static uint64_t highest(std::size_t index) {
+    if (index < 2 * Half) {
+      return index;
+    }
+    uint64_t shift = index / Half - 1;
+    uint64_t sub = index - shift * Half;
+    return ((sub + 1) << shift) - 1;
+  }
+};
+
+} // namespace internal
+
+template <class U, class R, int Precision>
+class HdrHistogram<Qty<U, R>, Precision> {
+  using Layout = internal::HdrLayout<Precision>;
+
+public:
+  using Quantity = Qty<U, R>;
+
+  /*
+   * A plain copy of the counts, which can be merged and queried
+   */
+  class Snapshot {
+  public:
+    Snapshot() : counts(Layout::Buckets, 0) {}
+
+    uint64_t total() const {
+      uint64_t res = 0;
+      for (uint64_t c : counts) {
+        res += c;
+      }
+      return res;
+    }
+
+    void merge(const Snapshot &other) {
+      for (std::size_t i = 0; i < counts.size(); ++i) {
+        counts[i] += other.counts[i];
+      }
+    }
+
+    /*
+     * The value below which percent % of the records are, within the
+     * precision of the histogram
+     */
+    Quantity percentile(double percent) const {
+      uint64_t count = total();
+      if (count == 0) {
+        return Quantity(0);
+      }
+      uint64_t rank = static_cast<uint64_t>(percent / 100.0 * count + 0.5);
+      rank = (rank == 0) ? 1 : (rank > count ? count : rank);
+
+      uint64_t seen = 0;
+      for (std::size_t i = 0; i < counts.size(); ++i) {
+        seen += counts[i];
+        if (seen >= rank) {
+          return Quantity(Layout::highest(i));
+        }
+      }
+      return Quantity(0);
+    }
+
+    Quantity max() const { return percentile(100.0); }
+
+  private:
+    friend class HdrHistogram;
+    std::vector<uint64_t> counts;
+  };
+
+  HdrHistogram() : counts(new std::atomic<uint64_t>[Layout::Buckets]) {
+    reset();
+  }
+
+  /*
+   * The value is rescaled at compile time, negative values count as 0
+   */
+  template <typename ROther> void record(Qty<U, ROther> q, uint64_t count = 1) {
+    intmax_t value = qtyFloorCast<Quantity>(q).value;
+    uint64_t raw = (value < 0) ? 0 : static_cast<uint64_t>(value);
+    counts[Layout::index(raw)].fetch_add(count, std::memory_order_relaxed);
+  }
+
+  Snapshot snapshot() const {
+    Snapshot res;
+    for (std::size_t i = 0; i < Layout::Buckets; ++i) {
+      res.counts[i] = counts[i].load(std::memory_order_relaxed);
+    }
+    return res;
+  }
+
+  void reset() {
+    for (std::size_t i = 0; i < Layout::Buckets; ++i) {
+      counts[i].store(0, std::memory_order_relaxed);
+    }
+  }
+
+private:
+  std::unique_ptr<std::atomic<uint64_t>[]> counts;
+};
+
+/*
+ * Latencies, recorded by default in nanoseconds
+ */
+template <class R = std::nano, int Precision = 7>
+using LatencyHistogram = HdrHistogram<Qty<Second, R>, Precision>;
+
+} // namespace phy
+
+#endif // HDR_HISTOGRAM_H
@@ -0,0 +1,229 @@
+#ifndef HISTOGRAM_H
+#define HISTOGRAM_H
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+#include "QtySpan.h"
+#include "Units.h"
+
+namespace phy {
+
+/*
+ * A histogram of quantities, the bins are [edge_k, edge_k+1).
+ * Values below the first edge or above the last one are counted apart.
+ */
+template <class Q> class Histogram;
+
+template <class U, class R> class Histogram<Qty<U, R>> {
+public:
+  using Quantity = Qty<U, R>;
+
+  /*
+   * Bins of the same width between lo and hi
+   */
+  template <typename RLo, typename RHi>
+  static Histogram uniform(Qty<U, RLo> lo, Qty<U, RHi> hi, std::size_t bins) {
+    intmax_t first = qtyCeilCast<Quantity>(lo).value;
+    intmax_t last = qtyCeilCast<Quantity>(hi).value;
+    if (bins == 0 || last <= first) {
+      throw std::invalid_argument("Histogram: empty range");
+    }
+
+    std::vector<intmax_t> edges;
+    for (std::size_t k = 0; k <= bins; ++k) {
+      __int128 offset = static_cast<__int128>(last - first) * k / bins;
+      edges.push_back(first + static_cast<intmax_t>(offset));
+    }
+    return Histogram(std::move(edges));
+  }
+
+  /*
+   * Bins whose widths grow geometrically between lo and hi. The edges are
+   * integers, so the narrowest bins are widened to one value: there can be
+   * at most hi - lo bins.
+   */
+  template <typename RLo, typename RHi>
+  static Histogram logarithmic(Qty<U, RLo> lo, Qty<U, RHi> hi,
+                               std::size_t bins) {
+    intmax_t first = qtyCeilCast<Quantity>(lo).value;
+    intmax_t last = qtyCeilCast<Quantity>(hi).value;
+    if (bins == 0 || first <= 0 || last <= first) {
+      throw std::invalid_argument("Histogram: invalid logarithmic range");
+    }
+    if (bins > static_cast<uint64_t>(last - first)) {
+      throw std::invalid_argument("Histogram: more logarithmic bins than "
+                                  "values in the range");
+    }
+
+    double factor = std::log(static_cast<double>(last) / first) / bins;
+    std::vector<intmax_t> edges{first};
+    for (std::size_t k = 1; k < bins; ++k) {
+      double edge = std::ceil(first * std::exp(factor * k));
+      intmax_t lowest = edges.back() + 1;
+      intmax_t highest = last - static_cast<intmax_t>(bins - k);
+      intmax_t value = static_cast<intmax_t>(edge);
+      value = (value < lowest) ? lowest : value;
+      edges.push_back((value > highest) ? highest : value);
+    }
+    edges.push_back(last);
+    return Histogram(std::move(edges));
+  }
+
+  /*
+   * Arbitrary increasing edges, in any ratio
+   */
+  template <typename REdge>
+  explicit Histogram(const std::vector<Qty<U, REdge>> &edges)
+      : Histogram(convert(edges)) {}
+
+  std::size_t bins() const { return edges.size() - 1; }
+
+  Quantity lowerEdge(std::size_t bin) const { return Quantity(edges[bin]); }
+  Quantity upperEdge(std::size_t bin) const { return Quantity(edges[bin + 1]); }
+
+  uint64_t count(std::size_t bin) const { return slotCount(bin + 1); }
+  uint64_t underflow() const { return slotCount(0); }
+  uint64_t overflow() const { return slotCount(bins() + 1); }
+
+  uint64_t total() const {
+    uint64_t res = 0;
+    for (uint64_t c : counts) {
+      res += c;
+    }
+    return res;
+  }
+
+  template <typename ROther> void insert(Qty<U, ROther> q) {
+    ++counts[slot(qtyFloorCast<Quantity>(q).value)];
+  }
+
+  /*
+   * Batch insertion: the slots are computed for a whole chunk first, then
+   * counted into Lanes interleaved copies of the counters so that repeated
+   * values do not serialise on the same memory location.
+   */
+  template <typename Q> void insert(QtySpan<Q> column) {
+    static_assert(std::is_same<typename QtySpan<Q>::Unit, U>::value,
+                  "the column must have the unit of the histogram");
+    static_assert(std::is_same<typename QtySpan<Q>::Ratio, R>::value,
+                  "the column must have the ratio of the histogram");
+
+    const intmax_t *values = column.values();
+    const std::size_t slots = bins() + 2;
+    uint32_t chunk[Chunk];
+
+    for (std::size_t i = 0; i < column.size(); i += Chunk) {
+      std::size_t end = (column.size() - i < Chunk) ? column.size() - i : Chunk;
+      for (std::size_t j = 0; j < end; ++j) {
+        chunk[j] = static_cast<uint32_t>(slot(values[i + j]));
+      }
+      for (std::size_t j = 0; j < end; ++j) {
+        ++counts[(j % Lanes) * slots + chunk[j]];
+      }
+    }
+  }
+
+  /*
+   * Adds the counts of another histogram with the same edges,
+   * typically a per-thread one
+   */
+  void merge(const Histogram &other) {
+    if (other.edges != edges) {
+      throw std::invalid_argument("Histogram: merging different edges");
+    }
+    for (std::size_t i = 0; i < counts.size(); ++i) {
+      counts[i] += other.counts[i];
+    }
+  }
+
+private:
+  static constexpr std::size_t Lanes = 4;
+  static constexpr std::size_t Chunk = 256;
+
+  template <typename REdge>
+  static std::vector<intmax_t> convert(const std::vector<Qty<U, REdge>> &edges) {
+    std::vector<intmax_t> res;
+    for (auto edge : edges) {
+      res.push_back(qtyCeilCast<Quantity>(edge).value);
+    }
+    return res;
+  }
+
+  explicit Histogram(std::vector<intmax_t> e) : edges(std::move(e)) {
+    if (edges.size() < 2) {
+      throw std::invalid_argument("Histogram: at least two edges are needed");
+    }
+    for (std::size_t k = 1; k < edges.size(); ++k) {
+      if (edges[k] <= edges[k - 1]) {
+        throw std::invalid_argument("Histogram: edges must be increasing");
+      }
+    }
+    counts.assign(Lanes * (bins() + 2), 0);
+
+    /*
+     * Uniform bins: the division by the width is replaced by a multiply-shift
+     * magic = floor(2^63 / width) + 1, exact up to one correction step
+     */
+    uint64_t width = edges[1] - edges[0];
+    uniformBins = true;
+    for (std::size_t k = 1; k < edges.size(); ++k) {
+      uint64_t w = edges[k] - edges[k - 1];
+      uniformBins = uniformBins && w == width;
+    }
+    range = static_cast<uint64_t>(edges.back() - edges.front());
+    uniformBins = uniformBins && range < (UINT64_C(1) << 63);
+    binWidth = width;
+    magic = static_cast<uint64_t>((UINT64_C(1) << 63) / width + 1);
+  }
+
+  uint64_t slotCount(std::size_t s) const {
+    const std::size_t slots = bins() + 2;
+    uint64_t res = 0;
+    for (std::size_t lane = 0; lane < Lanes; ++lane) {
+      res += counts[lane * slots + s];
+    }
+    return res;
+  }
+
+  /*
+   * 0 is the underflow, bins() + 1 the overflow
+   */
+  std::size_t slot(intmax_t value) const {
+    if (uniformBins) {
+      uint64_t d = static_cast<uint64_t>(value) - edges[0];
+      unsigned __int128 product = static_cast<unsigned __int128>(d) * magic;
+      uint64_t q = static_cast<uint64_t>(product >> 63);
+      q -= (q * binWidth > d);
+      std::size_t res = (d >= range) ? bins() + 1 : q + 1;
+      return (value < edges[0]) ? 0 : res;
+    }
+
+    /*
+     * Branchless search of the number of edges lower or equal to value
+     */
+    const intmax_t *base = edges.data();
+    std::size_t n = edges.size();
+    while (n > 1) {
+      std::size_t half = n / 2;
+      base = (base[half] <= value) ? base + half : base;
+      n -= half;
+    }
+    return (base - edges.data()) + (*base <= value);
+  }
+
+  std::vector<intmax_t> edges;
+  std::vector<uint64_t> counts;
+  bool uniformBins;
+  uint64_t range;
+  uint64_t binWidth;
+  uint64_t magic;
+};
+
+} // namespace phy
+
+#endif // HISTOGRAM_H
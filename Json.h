@@ -0,0 +1,518 @@
+#ifndef JSON_H
+#define JSON_H
+
+#include <charconv>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "Csv.h"
+#include "RuntimeUnit.h"
+#include "Units.h"
+
+namespace phy {
+
+/*
+ * A quantity whose unit is known at run time, the value being expressed
+ * in this unit
+ */
+struct RuntimeQuantity {
+  double value;
+  RuntimeUnit unit;
+};
+
+namespace internal {
+
+/*
+ * parseUnit with the units already seen by the thread cached by symbol
+ */
+inline const RuntimeUnit &cachedUnit(std::string_view symbol) {
+  thread_local std::deque<std::string> symbols;
+  thread_local std::unordered_map<std::string_view, RuntimeUnit> units;
+  auto it = units.find(symbol);
+  if (it == units.end()) {
+    RuntimeUnit unit = parseUnit(symbol);
+    symbols.emplace_back(symbol);
+    it = units.emplace(symbols.back(), unit).first;
+  }
+  return it->second;
+}
+
+/*
+ * The unit in base units, as understood by parseUnit: "m.kg.s-2", "1"
+ */
+inline std::string baseSymbol(const RuntimeUnit &unit) {
+  static const char *const symbols[] = {"m", "kg", "s", "A",
+                                        "K", "mol", "cd", "bit"};
+  std::string res;
+  for (std::size_t i = 0; i < RuntimeUnit::Dimensions; ++i) {
+    if (unit.exponents[i] != 0) {
+      res += (res.empty() ? "" : ".") + std::string(symbols[i]);
+      if (unit.exponents[i] != 1) {
+        res += std::to_string(unit.exponents[i]);
+      }
+    }
+  }
+  return res.empty() ? "1" : res;
+}
+
+/*
+ * The first '"' or '\\' of [p, end)
+ */
+inline const char *findStringEnd(const char *p, const char *end) {
+#if defined(__SSE2__)
+  const __m128i quote = _mm_set1_epi8('"');
+  const __m128i backslash = _mm_set1_epi8('\\');
+  for (; p + 16 <= end; p += 16) {
+    __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+    int mask = _mm_movemask_epi8(_mm_or_si128(
+        _mm_cmpeq_epi8(chunk, quote), _mm_cmpeq_epi8(chunk, backslash)));
+    if (mask != 0) {
+      return p + __builtin_ctz(mask);
+    }
+  }
+#endif
+  while (p < end && *p != '"' && *p != '\\') {
+    ++p;
+  }
+  return p;
+}
+
+/*
+ * The first structural character of a skipped value, '{', '}', '[', ']'
+ * or '"', of [p, end)
+ */
+inline const char *findStructural(const char *p, const char *end) {
+#if defined(__SSE2__)
+  // '[' and ']' are '{' and '}' without the bit 0x20
+  const __m128i open = _mm_set1_epi8('{');
+  const __m128i close = _mm_set1_epi8('}');
+  const __m128i quote = _mm_set1_epi8('"');
+  const __m128i lower = _mm_set1_epi8(0x20);
+  for (; p + 16 <= end; p += 16) {
+    __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+    __m128i folded = _mm_or_si128(chunk, lower);
+    int mask = _mm_movemask_epi8(
+        _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(folded, open),
+                                  _mm_cmpeq_epi8(folded, close)),
+                     _mm_cmpeq_epi8(chunk, quote)));
+    if (mask != 0) {
+      return p + __builtin_ctz(mask);
+    }
+  }
+#endif
+  while (p < end && *p != '{' && *p != '}' && *p != '[' && *p != ']' &&
+         *p != '"') {
+    ++p;
+  }
+  return p;
+}
+
+} // namespace internal
+
+/*
+ * A pull reader over a JSON document, which reads quantities written as
+ * {"value": 12.5, "unit": "km/h"} or as "12.5 km/h".
+ * Strings are returned as views on the document, their escapes kept as is.
+ */
+class JsonReader {
+public:
+  explicit JsonReader(std::string_view text)
+      : p(text.data()), end(text.data() + text.size()), first(false) {}
+
+  /*
+   * The next character which is not a space, or '\0' at the end
+   */
+  char peek() {
+    skipSpaces();
+    return (p < end) ? *p : '\0';
+  }
+
+  bool atEnd() { return peek() == '\0'; }
+
+  void beginObject() {
+    expect('{');
+    first = true;
+  }
+
+  /*
+   * Reads the key of the next member, returns false at the end of the object
+   */
+  bool nextMember(std::string_view &key) {
+    if (!nextItem('}')) {
+      return false;
+    }
+    key = readString();
+    expect(':');
+    return true;
+  }
+
+  void beginArray() {
+    expect('[');
+    first = true;
+  }
+
+  /*
+   * Returns false at the end of the array
+   */
+  bool nextElement() { return nextItem(']'); }
+
+  std::string_view readString() {
+    expect('"');
+    const char *begin = p;
+    for (;;) {
+      p = internal::findStringEnd(p, end);
+      if (p == end) {
+        throw std::runtime_error("JsonReader: unterminated string");
+      }
+      if (*p == '"') {
+        return std::string_view(begin, p++ - begin);
+      }
+      if (p + 1 >= end) {
+        throw std::runtime_error("JsonReader: unterminated string");
+      }
+      p += 2;
+    }
+  }
+
+  double readNumber() { return parseNumber(readNumberToken()); }
+
+  void skipValue() {
+    char c = peek();
+    if (c == '"') {
+      readString();
+    } else if (c == '{' || c == '[') {
+      int depth = 0;
+      do {
+        p = internal::findStructural(p, end);
+        if (p == end) {
+          throw std::runtime_error("JsonReader: unterminated value");
+        }
+        if (*p == '"') {
+          readString();
+          continue;
+        }
+        depth += (*p == '{' || *p == '[') ? 1 : -1;
+        ++p;
+      } while (depth > 0);
+    } else {
+      while (p < end && *p != ',' && *p != '}' && *p != ']' && *p != ' ' &&
+             *p != '\t' && *p != '\n' && *p != '\r') {
+        ++p;
+      }
+    }
+  }
+
+  RuntimeQuantity readQuantity() {
+    std::string_view number, unit;
+    readParts(number, unit);
+    return RuntimeQuantity{parseNumber(number), internal::cachedUnit(unit)};
+  }
+
+  /*
+   * Reads a quantity of the dimension of Q, converted exactly to its ratio
+   * and truncated like qtyCast
+   */
+  template <class Q> Q readQty() {
+    std::string_view number, unit;
+    readParts(number, unit);
+    RuntimeUnit factor = internal::cachedUnit(unit);
+    const RuntimeUnit expected =
+        RuntimeUnit::of<typename Q::Unit, typename Q::Ratio>();
+    if (!factor.sameDimension(expected)) {
+      throw std::runtime_error("JsonReader: unexpected unit '" +
+                               std::string(unit) + "'");
+    }
+    internal::combine(factor, expected, -1);
+    checkNumber(number);
+    return Q(internal::parseScaled(number, factor.num, factor.den));
+  }
+
+private:
+  void skipSpaces() {
+    while (p < end && (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r')) {
+      ++p;
+    }
+  }
+
+  void expect(char c) {
+    if (peek() != c) {
+      throw std::runtime_error(std::string("JsonReader: expected '") + c + "'");
+    }
+    ++p;
+  }
+
+  /*
+   * The items of a container are separated by exactly one ','
+   */
+  bool nextItem(char close) {
+    char c = peek();
+    if (c == close) {
+      ++p;
+      first = false;
+      return false;
+    }
+    if (!first) {
+      expect(',');
+      c = peek();
+    }
+    if (c == ',' || c == close) {
+      throw std::runtime_error("JsonReader: unexpected ','");
+    }
+    first = false;
+    return true;
+  }
+
+  /*
+   * The number grammar of RFC 8259, stricter than from_chars:
+   * -?(0|[1-9][0-9]*)(\.[0-9]+)?([eE][+-]?[0-9]+)?
+   */
+  static void checkNumber(std::string_view token) {
+    std::size_t i = 0;
+    auto digits = [&token, &i]() {
+      std::size_t start = i;
+      while (i < token.size() && token[i] >= '0' && token[i] <= '9') {
+        ++i;
+      }
+      return i - start;
+    };
+    if (i < token.size() && token[i] == '-') {
+      ++i;
+    }
+    bool valid = true;
+    if (i < token.size() && token[i] == '0') {
+      ++i;
+    } else {
+      valid = digits() > 0;
+    }
+    if (valid && i < token.size() && token[i] == '.') {
+      ++i;
+      valid = digits() > 0;
+    }
+    if (valid && i < token.size() && (token[i] == 'e' || token[i] == 'E')) {
+      ++i;
+      if (i < token.size() && (token[i] == '+' || token[i] == '-')) {
+        ++i;
+      }
+      valid = digits() > 0;
+    }
+    if (!valid || i != token.size()) {
+      throw std::runtime_error("JsonReader: invalid number '" +
+                               std::string(token) + "'");
+    }
+  }
+
+  static double parseNumber(std::string_view token) {
+    checkNumber(token);
+    double value = 0.0;
+    const char *last = token.data() + token.size();
+    auto res = std::from_chars(token.data(), last, value);
+    if (res.ec != std::errc() || res.ptr != last) {
+      throw std::runtime_error("JsonReader: invalid number '" +
+                               std::string(token) + "'");
+    }
+    return value;
+  }
+
+  std::string_view readNumberToken() {
+    skipSpaces();
+    const char *begin = p;
+    while (p < end && ((*p >= '0' && *p <= '9') || *p == '-' || *p == '+' ||
+                       *p == '.' || *p == 'e' || *p == 'E')) {
+      ++p;
+    }
+    if (p == begin) {
+      throw std::runtime_error("JsonReader: expected a number");
+    }
+    return std::string_view(begin, p - begin);
+  }
+
+  /*
+   * The number and the unit of a quantity, a missing unit being "1".
+   * In a string, they are separated by spaces: "12.5 km/h".
+   */
+  void readParts(std::string_view &number, std::string_view &unit) {
+    unit = "1";
+    if (peek() == '"') {
+      std::string_view text = readString();
+      std::size_t first = text.find_first_not_of(' ');
+      if (first == std::string_view::npos) {
+        throw std::runtime_error("JsonReader: empty quantity");
+      }
+      text = text.substr(first, text.find_last_not_of(' ') + 1 - first);
+      std::size_t space = text.find(' ');
+      number = text.substr(0, space);
+      if (space != std::string_view::npos) {
+        unit = text.substr(text.find_first_not_of(' ', space));
+      }
+      return;
+    }
+
+    bool hasValue = false;
+    std::string_view key;
+    beginObject();
+    while (nextMember(key)) {
+      if (key == "value") {
+        number = readNumberToken();
+        hasValue = true;
+      } else if (key == "unit") {
+        unit = readString();
+      } else {
+        skipValue();
+      }
+    }
+    if (!hasValue) {
+      throw std::runtime_error("JsonReader: quantity without value");
+    }
+  }
+
+  const char *p;
+  const char *end;
+  bool first; // no item read yet in the innermost container
+};
+
+/*
+ * A writer of JSON documents to a stream, which writes quantities as
+ * {"value": 12.5, "unit": "m.s-1"}, in base units
+ */
+class JsonWriter {
+public:
+  explicit JsonWriter(std::ostream &out) : out(out) {}
+
+  void beginObject() {
+    separate();
+    out << '{';
+    first.push_back(true);
+  }
+  void endObject() {
+    first.pop_back();
+    out << '}';
+  }
+
+  void beginArray() {
+    separate();
+    out << '[';
+    first.push_back(true);
+  }
+  void endArray() {
+    first.pop_back();
+    out << ']';
+  }
+
+  void key(std::string_view name) {
+    string(name);
+    out << ':';
+    afterKey = true;
+  }
+
+  /*
+   * The quotes, backslashes and control characters are escaped
+   */
+  void string(std::string_view text) {
+    static const char hex[] = "0123456789abcdef";
+    separate();
+    out << '"';
+    std::size_t begin = 0;
+    for (std::size_t i = 0; i < text.size(); ++i) {
+      unsigned char c = text[i];
+      if (c >= 0x20 && c != '"' && c != '\\') {
+        continue;
+      }
+      out.write(text.data() + begin, i - begin);
+      begin = i + 1;
+      switch (c) {
+      case '"':
+        out << "\\\"";
+        break;
+      case '\\':
+        out << "\\\\";
+        break;
+      case '\n':
+        out << "\\n";
+        break;
+      case '\r':
+        out << "\\r";
+        break;
+      case '\t':
+        out << "\\t";
+        break;
+      default:
+        out << "\\u00" << hex[c >> 4] << hex[c & 0xF];
+      }
+    }
+    out.write(text.data() + begin, text.size() - begin);
+    out << '"';
+  }
+
+  void number(double value) {
+    separate();
+    char buffer[32];
+    auto res = std::to_chars(buffer, buffer + sizeof(buffer), value);
+    out.write(buffer, res.ptr - buffer);
+  }
+
+  void number(intmax_t value) {
+    separate();
+    out << value;
+  }
+
+  void quantity(const RuntimeQuantity &q) {
+    beginObject();
+    key("value");
+    number(q.value * static_cast<double>(q.unit.num) /
+           static_cast<double>(q.unit.den));
+    key("unit");
+    string(internal::baseSymbol(q.unit));
+    endObject();
+  }
+
+  /*
+   * Integral values in base units are written exactly
+   */
+  template <typename U, typename R> void quantity(Qty<U, R> q) {
+    RuntimeUnit unit = RuntimeUnit::of<U, R>();
+    beginObject();
+    key("value");
+    intmax_t value;
+    if (R::den == 1 && !__builtin_mul_overflow(q.value, R::num, &value)) {
+      number(value);
+    } else {
+      number(static_cast<double>(q.value) * R::num / R::den);
+    }
+    key("unit");
+    string(internal::baseSymbol(unit));
+    endObject();
+  }
+
+private:
+  void separate() {
+    if (afterKey) {
+      afterKey = false;
+      return;
+    }
+    if (!first.empty()) {
+      if (!first.back()) {
+        out << ',';
+      }
+      first.back() = false;
+    }
+  }
+
+  std::ostream &out;
+  std::vector<bool> first;
+  bool afterKey = false;
+};
+
+} // namespace phy
+
+#endif // JSON_H
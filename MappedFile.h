@@ -0,0 +1,122 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <cstddef>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace phy {
+
+enum class MapMode { ReadOnly, ReadWrite };
+
+/*
+ * A whole file mapped in memory, read-only, or read-write when it is
+ * opened with MapMode::ReadWrite or created with its size
+ */
+class MappedFile {
+public:
+  /*
+   * Maps an existing file, without changing its size
+   */
+  explicit MappedFile(const std::string &path,
+                      MapMode mode = MapMode::ReadOnly)
+      : ptr(nullptr), length(0) {
+    const bool writable = (mode == MapMode::ReadWrite);
+    int fd = ::open(path.c_str(), writable ? O_RDWR : O_RDONLY);
+    if (fd < 0) {
+      throw std::runtime_error("MappedFile: cannot open " + path);
+    }
+    struct stat info;
+    if (::fstat(fd, &info) != 0) {
+      ::close(fd);
+      throw std::runtime_error("MappedFile: cannot stat " + path);
+    }
+    length = static_cast<std::size_t>(info.st_size);
+    if (length > 0) {
+      void *res =
+          ::mmap(nullptr, length,
+                 writable ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED,
+                 fd, 0);
+      if (res == MAP_FAILED) {
+        ::close(fd);
+        throw std::runtime_error("MappedFile: cannot map " + path);
+      }
+      ptr = static_cast<char *>(res);
+    }
+    ::close(fd);
+  }
+
+  /*
+   * Creates path with size bytes, mapped read-write. Throws if path already
+   * exists, whose data is left untouched.
+   */
+  MappedFile(const std::string &path, std::size_t size)
+      : ptr(nullptr), length(size) {
+    int fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_EXCL, 0644);
+    if (fd < 0) {
+      throw std::runtime_error("MappedFile: cannot create " + path);
+    }
+    if (::ftruncate(fd, static_cast<off_t>(size)) != 0) {
+      ::close(fd);
+      throw std::runtime_error("MappedFile: cannot resize " + path);
+    }
+    void *res =
+        ::mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (res == MAP_FAILED) {
+      ::close(fd);
+      throw std::runtime_error("MappedFile: cannot map " + path);
+    }
+    ptr = static_cast<char *>(res);
+    ::close(fd);
+  }
+
+  MappedFile(MappedFile &&other) noexcept
+      : ptr(std::exchange(other.ptr, nullptr)),
+        length(std::exchange(other.length, 0)) {}
+
+  MappedFile &operator=(MappedFile &&other) noexcept {
+    std::swap(ptr, other.ptr);
+    std::swap(length, other.length);
+    return *this;
+  }
+
+  MappedFile(const MappedFile &) = delete;
+  MappedFile &operator=(const MappedFile &) = delete;
+
+  ~MappedFile() {
+    if (ptr != nullptr) {
+      ::munmap(ptr, length);
+    }
+  }
+
+  const char *data() const { return ptr; }
+  std::size_t size() const { return length; }
+
+  /*
+   * The data of a file mapped read-write (the others are mapped read-only)
+   */
+  char *writableData() const { return ptr; }
+
+  /*
+   * Hints the kernel that the file will be read sequentially
+   */
+  void adviseSequential() const {
+    if (ptr != nullptr) {
+      ::madvise(ptr, length, MADV_SEQUENTIAL);
+    }
+  }
+
+private:
+  char *ptr;
+  std::size_t length;
+};
+
+} // namespace phy
+
+#endif // MAPPED_FILE_H
@@ -0,0 +1,314 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <charconv>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "AtomicQty.h"
+#include "HdrHistogram.h"
+#include "ShardedQty.h"
+#include "Units.h"
+
+namespace phy {
+
+namespace internal {
+
+inline void appendDimension(std::string &res, const char *name, int exponent) {
+  if (!res.empty()) {
+    res += '_';
+  }
+  res += name;
+  if (exponent > 1) {
+    res += std::to_string(exponent);
+  }
+}
+
+inline std::string formatDouble(double value) {
+  char buffer[32];
+  auto res = std::to_chars(buffer, buffer + sizeof(buffer), value);
+  return std::string(buffer, res.ptr);
+}
+
+} // namespace internal
+
+/*
+ * The name of a unit in base units, as used in metric names:
+ * Speed is "metres_per_second", Power "metres2_kilograms_per_second3"
+ */
+template <typename U> std::string baseUnitName() {
+  static const char *const plural[] = {"metres",  "kilograms", "seconds",
+                                       "amperes", "kelvins",   "moles",
+                                       "candelas", "bits"};
+  static const char *const singular[] = {"metre",  "kilogram", "second",
+                                         "ampere", "kelvin",   "mole",
+                                         "candela", "bit"};
+  const int exponents[] = {U::metre,  U::kilogram, U::second,
+                           U::ampere, U::kelvin,   U::mole,
+                           U::candela, U::bit};
+
+  std::string numerator;
+  std::string denominator;
+  for (int i = 0; i < 8; ++i) {
+    if (exponents[i] > 0) {
+      internal::appendDimension(numerator, plural[i], exponents[i]);
+    } else if (exponents[i] < 0) {
+      internal::appendDimension(denominator, singular[i], -exponents[i]);
+    }
+  }
+
+  if (denominator.empty()) {
+    return numerator;
+  }
+  return (numerator.empty() ? "" : numerator + "_") + "per_" + denominator;
+}
+
+/*
+ * The value of a quantity in base units
+ */
+template <typename U, typename R> double baseValue(Qty<U, R> q) {
+  return static_cast<double>(q.value) * R::num / R::den;
+}
+
+/*
+ * A metric of the registry, written in the Prometheus text format
+ */
+class Metric {
+public:
+  Metric(std::string name, std::string help)
+      : metricName(std::move(name)), metricHelp(std::move(help)) {}
+  virtual ~Metric() = default;
+
+  const std::string &name() const { return metricName; }
+
+  virtual void expose(std::ostream &out) const = 0;
+
+protected:
+  /*
+   * The help text is escaped as the exposition format requires: a
+   * backslash as \\ and a newline as \n
+   */
+  void header(std::ostream &out, const char *type) const {
+    out << "# HELP " << metricName << ' ';
+    for (char c : metricHelp) {
+      if (c == '\\') {
+        out << "\\\\";
+      } else if (c == '\n') {
+        out << "\\n";
+      } else {
+        out << c;
+      }
+    }
+    out << '\n';
+    out << "# TYPE " << metricName << ' ' << type << '\n';
+  }
+
+private:
+  std::string metricName;
+  std::string metricHelp;
+};
+
+namespace internal {
+
+inline std::string metricName(const std::string &name,
+                              const std::string &unit) {
+  if (unit.empty() || (name.size() > unit.size() &&
+                       name.compare(name.size() - unit.size() - 1,
+                                    std::string::npos, "_" + unit) == 0)) {
+    return name;
+  }
+  return name + "_" + unit;
+}
+
+} // namespace internal
+
+/*
+ * A monotonic counter, updated without contention. Adding a negative
+ * quantity throws std::invalid_argument.
+ */
+template <class Q> class Counter;
+
+template <class U, class R> class Counter<Qty<U, R>> : public Metric {
+public:
+  Counter(const std::string &name, std::string help)
+      : Metric(internal::metricName(name, baseUnitName<U>()) + "_total",
+               std::move(help)) {}
+
+  template <typename ROther> void add(Qty<U, ROther> q) {
+    if (q.value < 0) {
+      throw std::invalid_argument("Counter: negative increment");
+    }
+    value.add(q);
+  }
+
+  Qty<U, R> read() const { return value.read(); }
+
+  void expose(std::ostream &out) const override {
+    header(out, "counter");
+    out << name() << ' ' << internal::formatDouble(baseValue(read())) << '\n';
+  }
+
+private:
+  ShardedQty<U, R> value;
+};
+
+/*
+ * A value which can go up and down
+ */
+template <class Q> class Gauge;
+
+template <class U, class R> class Gauge<Qty<U, R>> : public Metric {
+public:
+  Gauge(const std::string &name, std::string help)
+      : Metric(internal::metricName(name, baseUnitName<U>()), std::move(help)) {
+  }
+
+  template <typename ROther> void set(Qty<U, ROther> q) {
+    value.store(q, std::memory_order_relaxed);
+  }
+
+  template <typename ROther> void add(Qty<U, ROther> q) {
+    value.fetch_add(q, std::memory_order_relaxed);
+  }
+
+  Qty<U, R> read() const { return value.load(std::memory_order_relaxed); }
+
+  void expose(std::ostream &out) const override {
+    header(out, "gauge");
+    out << name() << ' ' << internal::formatDouble(baseValue(read())) << '\n';
+  }
+
+private:
+  AtomicQty<U, R> value;
+};
+
+/*
+ * A distribution, exposed as a summary with its quantiles, the exact sum
+ * of its values and their count
+ */
+template <class Q> class Distribution;
+
+template <class U, class R> class Distribution<Qty<U, R>> : public Metric {
+public:
+  Distribution(const std::string &name, std::string help)
+      : Metric(internal::metricName(name, baseUnitName<U>()), std::move(help)) {
+  }
+
+  template <typename ROther> void record(Qty<U, ROther> q) {
+    values.record(q);
+    sum.add(q);
+  }
+
+  typename HdrHistogram<Qty<U, R>>::Snapshot snapshot() const {
+    return values.snapshot();
+  }
+
+  void expose(std::ostream &out) const override {
+    static const char *const quantiles[] = {"0.5", "0.9", "0.99", "0.999"};
+    static const double percents[] = {50.0, 90.0, 99.0, 99.9};
+
+    auto current = values.snapshot();
+    header(out, "summary");
+    for (int i = 0; i < 4; ++i) {
+      out << name() << "{quantile=\"" << quantiles[i] << "\"} "
+          << internal::formatDouble(baseValue(current.percentile(percents[i])))
+          << '\n';
+    }
+    out << name() << "_sum " << internal::formatDouble(baseValue(sum.read()))
+        << '\n';
+    out << name() << "_count " << current.total() << '\n';
+  }
+
+private:
+  HdrHistogram<Qty<U, R>> values;
+  ShardedQty<U, R> sum;
+};
+
+/*
+ * The registry of the metrics of the process. Registering takes a lock,
+ * updating a metric never does, and exposing only blocks registrations.
+ */
+class MetricsRegistry {
+public:
+  static MetricsRegistry &global() {
+    static MetricsRegistry registry;
+    return registry;
+  }
+
+  template <class Q>
+  Counter<Q> &counter(const std::string &name, const std::string &help) {
+    return add<Counter<Q>>(name, help);
+  }
+
+  template <class Q>
+  Gauge<Q> &gauge(const std::string &name, const std::string &help) {
+    return add<Gauge<Q>>(name, help);
+  }
+
+  template <class Q>
+  Distribution<Q> &distribution(const std::string &name,
+                                const std::string &help) {
+    return add<Distribution<Q>>(name, help);
+  }
+
+  void expose(std::ostream &out) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    for (const auto &metric : metrics) {
+      metric->expose(out);
+    }
+  }
+
+  /*
+   * Writes the exposition to a file, replaced atomically
+   */
+  void dump(const std::string &path) const {
+    std::string tmp = path + ".tmp";
+    {
+      std::ofstream out(tmp);
+      expose(out);
+      if (!out) {
+        throw std::runtime_error("MetricsRegistry: cannot write " + tmp);
+      }
+    }
+    if (std::rename(tmp.c_str(), path.c_str()) != 0) {
+      throw std::runtime_error("MetricsRegistry: cannot write " + path);
+    }
+  }
+
+private:
+  /*
+   * A metric registered twice is shared, as long as its type is the same
+   */
+  template <class M> M &add(const std::string &name, const std::string &help) {
+    auto metric = std::make_unique<M>(name, help);
+
+    std::lock_guard<std::mutex> lock(mutex);
+    for (const auto &other : metrics) {
+      if (other->name() == metric->name()) {
+        M *res = dynamic_cast<M *>(other.get());
+        if (res == nullptr) {
+          throw std::invalid_argument("MetricsRegistry: " + name +
+                                      " has another type");
+        }
+        return *res;
+      }
+    }
+    metrics.push_back(std::move(metric));
+    return static_cast<M &>(*metrics.back());
+  }
+
+  mutable std::mutex mutex;
+  std::vector<std::unique_ptr<Metric>> metrics;
+};
+
+} // namespace phy
+
+#endif // METRICS_H
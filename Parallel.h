@@ -0,0 +1,141 @@
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+#include "QtySpan.h"
+#include "Scan.h"
+#include "ThreadPool.h"
+#include "Units.h"
+
+namespace phy {
+
+namespace internal {
+
+template <class Q, class F, class... Qs>
+using TransformResult = typename std::decay<decltype(std::declval<F &>()(
+    std::declval<Q &>(), std::declval<Qs &>()...))>::type;
+
+} // namespace internal
+
+/*
+ * Parallel algorithms over columns of quantities, run on chunks sized for
+ * the cache by the tasks of a pool. The types of the results follow from
+ * the unit arithmetic of the functions.
+ */
+namespace parallel {
+
+template <class Q, class F>
+void for_each(QtySpan<Q> column, F f, ThreadPool &pool = ThreadPool::global()) {
+  const std::size_t chunk = internal::cacheChunk();
+  internal::parallelChunks(
+      pool, internal::chunkCount(column.size()), [&](std::size_t i) {
+        std::size_t end = (i + 1) * chunk;
+        end = (end < column.size()) ? end : column.size();
+        for (std::size_t j = i * chunk; j < end; ++j) {
+          f(column[j]);
+        }
+      });
+}
+
+/*
+ * The column of f(q) for each q of column
+ */
+template <class Q, class F>
+QtyVector<internal::TransformResult<Q, F>>
+transform(QtySpan<Q> column, F f, ThreadPool &pool = ThreadPool::global()) {
+  using Result = internal::TransformResult<Q, F>;
+  const std::size_t chunk = internal::cacheChunk();
+  QtyVector<Result> res(column.size(), Result(0));
+  internal::parallelChunks(
+      pool, internal::chunkCount(column.size()), [&](std::size_t i) {
+        std::size_t end = (i + 1) * chunk;
+        end = (end < column.size()) ? end : column.size();
+        for (std::size_t j = i * chunk; j < end; ++j) {
+          res[j] = f(column[j]);
+        }
+      });
+  return res;
+}
+
+/*
+ * The column of f(a, b) for each pair of values of first and second
+ */
+template <class Q1, class Q2, class F>
+QtyVector<internal::TransformResult<Q1, F, Q2>>
+transform(QtySpan<Q1> first, QtySpan<Q2> second, F f,
+          ThreadPool &pool = ThreadPool::global()) {
+  using Result = internal::TransformResult<Q1, F, Q2>;
+  if (first.size() != second.size()) {
+    throw std::invalid_argument("parallel::transform: columns of different "
+                                "sizes");
+  }
+  const std::size_t chunk = internal::cacheChunk();
+  QtyVector<Result> res(first.size(), Result(0));
+  internal::parallelChunks(
+      pool, internal::chunkCount(first.size()), [&](std::size_t i) {
+        std::size_t end = (i + 1) * chunk;
+        end = (end < first.size()) ? end : first.size();
+        for (std::size_t j = i * chunk; j < end; ++j) {
+          res[j] = f(first[j], second[j]);
+        }
+      });
+  return res;
+}
+
+/*
+ * Folds the column with the associative op, from init
+ */
+template <class Q, class Op>
+typename QtySpan<Q>::Quantity
+reduce(QtySpan<Q> column, typename QtySpan<Q>::Quantity init, Op op,
+       ThreadPool &pool = ThreadPool::global()) {
+  using Quantity = typename QtySpan<Q>::Quantity;
+  const std::size_t chunk = internal::cacheChunk();
+  const std::size_t chunks = internal::chunkCount(column.size());
+  QtyVector<Quantity> partials(chunks, Quantity(0));
+  internal::parallelChunks(pool, chunks, [&](std::size_t i) {
+    std::size_t end = (i + 1) * chunk;
+    end = (end < column.size()) ? end : column.size();
+    Quantity partial = column[i * chunk];
+    for (std::size_t j = i * chunk + 1; j < end; ++j) {
+      partial = op(partial, column[j]);
+    }
+    partials[i] = partial;
+  });
+  for (const Quantity &partial : partials) {
+    init = op(init, partial);
+  }
+  return init;
+}
+
+/*
+ * The sum of the column
+ */
+template <class Q>
+typename QtySpan<Q>::Quantity reduce(QtySpan<Q> column,
+                                     ThreadPool &pool = ThreadPool::global()) {
+  using Quantity = typename QtySpan<Q>::Quantity;
+  return reduce(
+      column, Quantity(0),
+      [](Quantity a, Quantity b) { return Quantity(a.value + b.value); }, pool);
+}
+
+/*
+ * The running sums of the column, see phy::inclusive_scan
+ */
+template <class Q>
+QtyVector<typename QtySpan<Q>::Quantity>
+inclusive_scan(QtySpan<Q> column, ThreadPool &pool = ThreadPool::global()) {
+  return phy::inclusive_scan(column, ScanOverflow::Wrap, pool);
+}
+
+} // namespace parallel
+
+} // namespace phy
+
+#endif // PARALLEL_H
@@ -0,0 +1,348 @@
+#ifndef PIPELINE_H
+#define PIPELINE_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "QtySpan.h"
+#include "ThreadPool.h"
+#include "Units.h"
+
+namespace phy {
+
+namespace internal {
+
+/*
+ * The batches returned by a stage: a QtyVector is one batch, a vector of
+ * QtyVector zero or more batches
+ */
+template <class T> struct StageBatches : std::false_type {};
+
+template <class U, class R>
+struct StageBatches<QtyVector<Qty<U, R>>> : std::true_type {
+  using Quantity = Qty<U, R>;
+};
+
+template <class U, class R>
+struct StageBatches<std::vector<QtyVector<Qty<U, R>>>> : std::true_type {
+  using Quantity = Qty<U, R>;
+};
+
+class PipelineNode {
+public:
+  virtual ~PipelineNode() = default;
+};
+
+template <class In> class StageInput : public PipelineNode {
+public:
+  virtual void accept(QtyVector<In> batch) = 0;
+};
+
+/*
+ * The bookkeeping shared by the stages of a pipeline: the batches pushed
+ * and not yet consumed by the sink, and the stage tasks on the pool
+ */
+template <class In> struct PipelineState {
+  PipelineState(ThreadPool &pool, std::size_t limit)
+      : pool(pool), limit(limit == 0 ? 1 : limit), head(nullptr) {}
+
+  void acquire() {
+    std::unique_lock<std::mutex> lock(mutex);
+    changed.wait(lock, [this]() { return inFlight < limit; });
+    ++inFlight;
+  }
+
+  void done() {
+    std::lock_guard<std::mutex> lock(mutex);
+    --inFlight;
+    changed.notify_all();
+  }
+
+  /*
+   * A batch turned into count batches by a stage, which may exceed the
+   * limit until the sink consumed them
+   */
+  void split(std::size_t count) {
+    std::lock_guard<std::mutex> lock(mutex);
+    inFlight = inFlight + count - 1;
+    changed.notify_all();
+  }
+
+  void taskStarted() {
+    std::lock_guard<std::mutex> lock(mutex);
+    ++tasks;
+  }
+
+  /*
+   * The last access of a task to its pipeline
+   */
+  void taskFinished() {
+    std::lock_guard<std::mutex> lock(mutex);
+    --tasks;
+    changed.notify_all();
+  }
+
+  void fail(std::exception_ptr e) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!error) {
+      error = e;
+    }
+  }
+
+  bool failed() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return static_cast<bool>(error);
+  }
+
+  std::exception_ptr wait() {
+    std::unique_lock<std::mutex> lock(mutex);
+    changed.wait(lock, [this]() { return inFlight == 0 && tasks == 0; });
+    return std::exchange(error, nullptr);
+  }
+
+  ThreadPool &pool;
+  const std::size_t limit;
+  std::mutex mutex;
+  std::condition_variable changed;
+  std::size_t inFlight = 0;
+  std::size_t tasks = 0;
+  std::exception_ptr error;
+  std::vector<std::unique_ptr<PipelineNode>> nodes;
+  StageInput<In> *head;
+};
+
+/*
+ * A stage processing its batches one at a time and in order, in a task of
+ * the pool scheduled when a batch arrives while the stage is idle
+ */
+template <class Source, class In> class SerialStage : public StageInput<In> {
+public:
+  explicit SerialStage(PipelineState<Source> &state)
+      : state(state), scheduled(false) {}
+
+  void accept(QtyVector<In> batch) override {
+    bool schedule;
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      batches.push_back(std::move(batch));
+      schedule = !scheduled;
+      scheduled = true;
+    }
+    if (schedule) {
+      state.taskStarted();
+      state.pool.submit([this]() { drain(); });
+    }
+  }
+
+protected:
+  virtual void process(QtyVector<In> &batch) = 0;
+
+  PipelineState<Source> &state;
+
+private:
+  void drain() {
+    for (;;) {
+      QtyVector<In> batch;
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (batches.empty()) {
+          scheduled = false;
+          break;
+        }
+        batch = std::move(batches.front());
+        batches.pop_front();
+      }
+      if (state.failed()) {
+        state.done();
+        continue;
+      }
+      try {
+        process(batch);
+      } catch (...) {
+        state.fail(std::current_exception());
+        state.done();
+      }
+    }
+    state.taskFinished();
+  }
+
+  std::mutex mutex;
+  std::deque<QtyVector<In>> batches;
+  bool scheduled;
+};
+
+template <class Source, class In, class Out, class Result>
+class MapStage : public SerialStage<Source, In> {
+public:
+  using Function = std::function<Result(QtySpan<const In>)>;
+
+  MapStage(PipelineState<Source> &state, Function function)
+      : SerialStage<Source, In>(state), next(nullptr),
+        function(std::move(function)) {}
+
+  StageInput<Out> *next;
+
+protected:
+  void process(QtyVector<In> &batch) override {
+    emit(function(QtySpan<const In>(batch)));
+  }
+
+private:
+  void emit(QtyVector<Out> res) { next->accept(std::move(res)); }
+
+  void emit(std::vector<QtyVector<Out>> res) {
+    this->state.split(res.size());
+    for (auto &batch : res) {
+      next->accept(std::move(batch));
+    }
+  }
+
+  Function function;
+};
+
+template <class Source, class In>
+class SinkStage : public SerialStage<Source, In> {
+public:
+  using Function = std::function<void(QtySpan<const In>)>;
+
+  SinkStage(PipelineState<Source> &state, Function function)
+      : SerialStage<Source, In>(state), function(std::move(function)) {}
+
+protected:
+  void process(QtyVector<In> &batch) override {
+    function(QtySpan<const In>(batch));
+    this->state.done();
+  }
+
+private:
+  Function function;
+};
+
+} // namespace internal
+
+/*
+ * A running pipeline fed with batches of In. At most the given number of
+ * batches are in the pipeline at once: push() blocks beyond, which bounds
+ * the memory of the stages whatever their speed.
+ */
+template <class In> class Pipeline {
+public:
+  explicit Pipeline(std::unique_ptr<internal::PipelineState<In>> state)
+      : state(std::move(state)) {}
+
+  Pipeline(Pipeline &&) = default;
+  Pipeline &operator=(Pipeline &&) = delete;
+
+  ~Pipeline() {
+    if (state) {
+      state->wait();
+    }
+  }
+
+  void push(QtyVector<In> batch) {
+    state->acquire();
+    state->head->accept(std::move(batch));
+  }
+
+  /*
+   * Waits until the sink consumed every batch, rethrows the first
+   * exception of a stage
+   */
+  void finish() {
+    if (std::exception_ptr error = state->wait()) {
+      std::rethrow_exception(error);
+    }
+  }
+
+private:
+  std::unique_ptr<internal::PipelineState<In>> state;
+};
+
+/*
+ * The builder of a pipeline whose stages turn batches of In into batches
+ * of Out. Each stage is a function from a QtySpan<const T> to a QtyVector
+ * of any quantity, whose type is deduced, so the units are checked at
+ * compile time from one stage to the next. A stage returning a vector of
+ * QtyVector emits zero or more batches instead of one. The stages run as
+ * tasks of a shared pool, each stage handling its batches in order.
+ */
+template <class In, class Out = In> class PipelineBuilder {
+public:
+  explicit PipelineBuilder(std::size_t maxBatches = 4,
+                           ThreadPool &pool = ThreadPool::global())
+      : state(new internal::PipelineState<In>(pool, maxBatches)),
+        tail(&state->head) {}
+
+  PipelineBuilder(std::unique_ptr<internal::PipelineState<In>> state,
+                  internal::StageInput<Out> **tail)
+      : state(std::move(state)), tail(tail) {}
+
+  template <class F> auto then(F function) && {
+    using Result = decltype(function(std::declval<QtySpan<const Out>>()));
+    static_assert(internal::StageBatches<Result>::value,
+                  "a stage must return a vector of quantities or of batches");
+    using Next = typename internal::StageBatches<Result>::Quantity;
+
+    auto stage =
+        new internal::MapStage<In, Out, Next, Result>(*state, function);
+    state->nodes.emplace_back(stage);
+    *tail = stage;
+    return PipelineBuilder<In, Next>(std::move(state), &stage->next);
+  }
+
+  template <class F> Pipeline<In> sink(F function) && {
+    auto stage = new internal::SinkStage<In, Out>(*state, function);
+    state->nodes.emplace_back(stage);
+    *tail = stage;
+    return Pipeline<In>(std::move(state));
+  }
+
+private:
+  std::unique_ptr<internal::PipelineState<In>> state;
+  internal::StageInput<Out> **tail;
+};
+
+namespace stages {
+
+/*
+ * Converts every quantity to Q with qtyCast
+ */
+template <class Q> auto convert() {
+  return [](auto batch) {
+    QtyVector<Q> res;
+    res.reserve(batch.size());
+    for (auto q : batch) {
+      res.push_back(qtyCast<Q>(q));
+    }
+    return res;
+  };
+}
+
+/*
+ * Multiplies every quantity by factor, the unit of the result following
+ * the rules of operator*
+ */
+template <class U, class R> auto multiply(Qty<U, R> factor) {
+  return [factor](auto batch) {
+    QtyVector<decltype(*batch.begin() * factor)> res;
+    res.reserve(batch.size());
+    for (auto q : batch) {
+      res.push_back(q * factor);
+    }
+    return res;
+  };
+}
+
+} // namespace stages
+
+} // namespace phy
+
+#endif // PIPELINE_H
@@ -0,0 +1,85 @@
+#ifndef QTY_SPAN_H
+#define QTY_SPAN_H
+
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "Units.h"
+
+namespace phy {
+
+/*
+ * A non-owning view over a contiguous column of quantities.
+ * Q may be const-qualified for read-only columns.
+ */
+template <class Q> class QtySpan {
+public:
+  using Quantity = typename std::remove_const<Q>::type;
+  using Unit = typename Quantity::Unit;
+  using Ratio = typename Quantity::Ratio;
+  using Value = typename std::conditional<std::is_const<Q>::value,
+                                          const intmax_t, intmax_t>::type;
+
+  static_assert(sizeof(Quantity) == sizeof(intmax_t),
+                "a quantity must be laid out as its raw value");
+
+  QtySpan() : ptr(nullptr), count(0) {}
+  QtySpan(Q *data, std::size_t size) : ptr(data), count(size) {}
+
+  /*
+   * Any contiguous container (std::vector, std::array, QtySpan...)
+   */
+  template <class Container,
+            typename = typename std::enable_if<std::is_convertible<
+                decltype(std::declval<Container &>().data()), Q *>::value>::type>
+  QtySpan(Container &container)
+      : ptr(container.data()), count(container.size()) {}
+
+  /*
+   * A read-only view of a mutable span
+   */
+  template <class Other,
+            typename = typename std::enable_if<
+                std::is_convertible<Other *, Q *>::value>::type>
+  QtySpan(const QtySpan<Other> &other)
+      : ptr(other.data()), count(other.size()) {}
+
+  Q *data() const { return ptr; }
+  std::size_t size() const { return count; }
+  bool empty() const { return count == 0; }
+
+  Q &operator[](std::size_t i) const { return ptr[i]; }
+  Q *begin() const { return ptr; }
+  Q *end() const { return ptr + count; }
+
+  QtySpan subspan(std::size_t offset, std::size_t length) const {
+    return QtySpan(ptr + offset, length);
+  }
+
+  /*
+   * The raw values of the column, for the vectorised kernels
+   */
+  Value *values() const { return reinterpret_cast<Value *>(ptr); }
+
+private:
+  Q *ptr;
+  std::size_t count;
+};
+
+template <typename U, typename R, typename Alloc>
+QtySpan(std::vector<Qty<U, R>, Alloc> &) -> QtySpan<Qty<U, R>>;
+
+template <typename U, typename R, typename Alloc>
+QtySpan(const std::vector<Qty<U, R>, Alloc> &) -> QtySpan<const Qty<U, R>>;
+
+/*
+ * An owning column of quantities
+ */
+template <class Q> using QtyVector = std::vector<Q>;
+
+} // namespace phy
+
+#endif // QTY_SPAN_H
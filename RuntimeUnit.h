@@ -0,0 +1,230 @@
+#ifndef RUNTIME_UNIT_H
+#define RUNTIME_UNIT_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <numeric>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+#include "Units.h"
+
+namespace phy {
+
+/*
+ * A unit known at run time: the exponents of the base units, in the order
+ * of Unit, and the ratio to the base units
+ */
+struct RuntimeUnit {
+  static constexpr std::size_t Dimensions = 8;
+
+  std::array<int, Dimensions> exponents;
+  intmax_t num;
+  intmax_t den;
+
+  template <typename U, typename R = std::ratio<1>> static RuntimeUnit of() {
+    return RuntimeUnit{{U::metre, U::kilogram, U::second, U::ampere,
+                        U::kelvin, U::mole, U::candela, U::bit},
+                       R::num,
+                       R::den};
+  }
+
+  template <typename U> bool hasDimension() const {
+    return exponents == of<U>().exponents;
+  }
+
+  bool sameDimension(const RuntimeUnit &other) const {
+    return exponents == other.exponents;
+  }
+
+  bool operator==(const RuntimeUnit &other) const {
+    return exponents == other.exponents && num == other.num && den == other.den;
+  }
+  bool operator!=(const RuntimeUnit &other) const { return !(*this == other); }
+};
+
+namespace internal {
+
+inline intmax_t checkedMultiply(intmax_t a, intmax_t b) {
+  intmax_t res;
+  if (__builtin_mul_overflow(a, b, &res)) {
+    throw std::overflow_error("RuntimeUnit: ratio overflow");
+  }
+  return res;
+}
+
+/*
+ * this *= other^power
+ */
+inline void combine(RuntimeUnit &unit, const RuntimeUnit &other, int power) {
+  for (std::size_t i = 0; i < RuntimeUnit::Dimensions; ++i) {
+    unit.exponents[i] += other.exponents[i] * power;
+  }
+  for (int i = 0; i < (power < 0 ? -power : power); ++i) {
+    intmax_t num = (power > 0) ? other.num : other.den;
+    intmax_t den = (power > 0) ? other.den : other.num;
+    intmax_t g1 = std::gcd(num, unit.den);
+    intmax_t g2 = std::gcd(unit.num, den);
+    unit.num = checkedMultiply(unit.num / g2, num / g1);
+    unit.den = checkedMultiply(unit.den / g1, den / g2);
+  }
+}
+
+struct UnitSymbol {
+  const char *symbol;
+  RuntimeUnit unit;
+};
+
+inline const UnitSymbol *findSymbol(std::string_view symbol) {
+  static const UnitSymbol symbols[] = {
+      {"m", RuntimeUnit::of<Metre>()},
+      {"g", RuntimeUnit::of<Kilogram, std::milli>()},
+      {"s", RuntimeUnit::of<Second>()},
+      {"min", RuntimeUnit::of<Second, std::ratio<60>>()},
+      {"h", RuntimeUnit::of<Second, std::ratio<3600>>()},
+      {"A", RuntimeUnit::of<Ampere>()},
+      {"K", RuntimeUnit::of<Kelvin>()},
+      {"mol", RuntimeUnit::of<Mole>()},
+      {"cd", RuntimeUnit::of<Candela>()},
+      {"rad", RuntimeUnit::of<Radian>()},
+      {"bit", RuntimeUnit::of<Bit>()},
+      {"b", RuntimeUnit::of<Bit>()},
+      {"B", RuntimeUnit::of<Bit, std::ratio<8>>()},
+      {"L", RuntimeUnit::of<details::Volume, std::milli>()},
+      {"Hz", RuntimeUnit::of<details::Frequency>()},
+      {"N", RuntimeUnit::of<details::Force>()},
+      {"J", RuntimeUnit::of<details::Energy>()},
+      {"W", RuntimeUnit::of<details::Power>()},
+      {"Pa", RuntimeUnit::of<details::Pressure>()},
+      {"C", RuntimeUnit::of<details::ElectricCharge>()},
+      {"V", RuntimeUnit::of<details::Voltage>()},
+      {"Ohm", RuntimeUnit::of<details::ElectricalResistance>()},
+      {"F", RuntimeUnit::of<details::ElectricCapacity>()},
+      {"T", RuntimeUnit::of<details::MagneticField>()},
+  };
+  for (const auto &entry : symbols) {
+    if (symbol == entry.symbol) {
+      return &entry;
+    }
+  }
+  return nullptr;
+}
+
+struct UnitPrefix {
+  const char *prefix;
+  intmax_t num;
+  intmax_t den;
+};
+
+inline const UnitPrefix *findPrefix(std::string_view prefix) {
+  static const UnitPrefix prefixes[] = {
+      {"p", 1, 1000000000000}, {"n", 1, 1000000000}, {"u", 1, 1000000},
+      {"m", 1, 1000},          {"c", 1, 100},        {"d", 1, 10},
+      {"h", 100, 1},           {"k", 1000, 1},       {"M", 1000000, 1},
+      {"G", 1000000000, 1},    {"T", 1000000000000, 1},
+      {"Ki", INTMAX_C(1) << 10, 1}, {"Mi", INTMAX_C(1) << 20, 1},
+      {"Gi", INTMAX_C(1) << 30, 1}, {"Ti", INTMAX_C(1) << 40, 1},
+  };
+  for (const auto &entry : prefixes) {
+    if (prefix == entry.prefix) {
+      return &entry;
+    }
+  }
+  return nullptr;
+}
+
+/*
+ * A symbol alone ("min", "T"), or a prefix and a symbol ("mm", "KiB")
+ */
+inline RuntimeUnit parseTerm(std::string_view term) {
+  if (const UnitSymbol *symbol = findSymbol(term)) {
+    return symbol->unit;
+  }
+  for (std::size_t length = 1; length <= 2 && length < term.size(); ++length) {
+    const UnitPrefix *prefix = findPrefix(term.substr(0, length));
+    const UnitSymbol *symbol = findSymbol(term.substr(length));
+    if (prefix != nullptr && symbol != nullptr) {
+      RuntimeUnit res = symbol->unit;
+      combine(res, RuntimeUnit{{}, prefix->num, prefix->den}, 1);
+      return res;
+    }
+  }
+  throw std::invalid_argument("parseUnit: unknown unit '" +
+                              std::string(term) + "'");
+}
+
+} // namespace internal
+
+/*
+ * Parses a unit symbol such as "km", "km/h", "m.s-2", "kg*m^2/s^2", "1/s"
+ * or "KiB".
+ * A '/' divides by the term which follows it only.
+ */
+inline RuntimeUnit parseUnit(std::string_view text) {
+  RuntimeUnit res{{}, 1, 1};
+  std::size_t pos = 0;
+  int sign = 1;
+
+  while (pos < text.size()) {
+    std::size_t end = pos;
+    while (end < text.size() &&
+           ((text[end] >= 'a' && text[end] <= 'z') ||
+            (text[end] >= 'A' && text[end] <= 'Z'))) {
+      ++end;
+    }
+    std::string_view term = text.substr(pos, end - pos);
+
+    if (end < text.size() && text[end] == '^') {
+      ++end;
+    }
+    int power = 1;
+    bool negative = false;
+    if (end < text.size() && text[end] == '-') {
+      negative = true;
+      ++end;
+    }
+    if (end < text.size() && text[end] >= '0' && text[end] <= '9') {
+      power = 0;
+      while (end < text.size() && text[end] >= '0' && text[end] <= '9') {
+        power = power * 10 + (text[end] - '0');
+        ++end;
+      }
+    }
+    power = negative ? -power : power;
+
+    if (term.empty()) {
+      /*
+       * "1" stands for the dimensionless unit, as in "1" or "1/s"
+       */
+      if (text.substr(pos, end - pos) != "1") {
+        throw std::invalid_argument("parseUnit: invalid unit '" +
+                                    std::string(text) + "'");
+      }
+    } else {
+      internal::combine(res, internal::parseTerm(term), sign * power);
+    }
+
+    sign = 1;
+    if (end < text.size()) {
+      char separator = text[end];
+      if (separator == '/') {
+        sign = -1;
+      } else if (separator != '.' && separator != '*') {
+        throw std::invalid_argument("parseUnit: invalid unit '" +
+                                    std::string(text) + "'");
+      }
+      if (++end == text.size()) {
+        throw std::invalid_argument("parseUnit: invalid unit '" +
+                                    std::string(text) + "'");
+      }
+    }
+    pos = end;
+  }
+  return res;
+}
+
+} // namespace phy
+
+#endif // RUNTIME_UNIT_H
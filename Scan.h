@@ -0,0 +1,170 @@
+#ifndef SCAN_H
+#define SCAN_H
+
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+#include "AtomicQty.h"
+#include "QtySpan.h"
+#include "ThreadPool.h"
+#include "Units.h"
+
+namespace phy {
+
+/*
+ * Wrap lets the running sums wrap around like the additions of Qty,
+ * Check computes them on 128 bits and throws std::overflow_error when one
+ * of them does not fit in the representation
+ */
+enum class ScanOverflow { Wrap, Check };
+
+namespace internal {
+
+inline intmax_t wrappingAdd(intmax_t a, intmax_t b) {
+  return static_cast<intmax_t>(static_cast<uint64_t>(a) +
+                               static_cast<uint64_t>(b));
+}
+
+/*
+ * out[i] = carry + values[0] + ... + values[i], returns the last sum.
+ * With AVX2, each group of 4 values is scanned in a register by two
+ * shifted additions, then offset by the broadcast carry.
+ */
+inline intmax_t scanChunk(const intmax_t *values, std::size_t size,
+                          intmax_t carry, intmax_t *out) {
+  std::size_t i = 0;
+
+#if defined(__AVX2__)
+  const __m256i zero = _mm256_setzero_si256();
+  __m256i vcarry = _mm256_set1_epi64x(carry);
+  for (; i + 4 <= size; i += 4) {
+    __m256i x =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i *>(values + i));
+    x = _mm256_add_epi64(
+        x, _mm256_blend_epi32(
+               _mm256_permute4x64_epi64(x, _MM_SHUFFLE(2, 1, 0, 0)), zero,
+               0x03));
+    x = _mm256_add_epi64(
+        x, _mm256_blend_epi32(
+               _mm256_permute4x64_epi64(x, _MM_SHUFFLE(1, 0, 0, 0)), zero,
+               0x0F));
+    x = _mm256_add_epi64(x, vcarry);
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(out + i), x);
+    vcarry = _mm256_permute4x64_epi64(x, _MM_SHUFFLE(3, 3, 3, 3));
+  }
+  if (i > 0) {
+    carry = out[i - 1];
+  }
+#endif
+
+  for (; i < size; ++i) {
+    carry = wrappingAdd(carry, values[i]);
+    out[i] = carry;
+  }
+  return carry;
+}
+
+inline intmax_t checkedValue(__int128 sum) {
+  if (sum > INTMAX_MAX || sum < INTMAX_MIN) {
+    throw std::overflow_error("scan: running sum out of range");
+  }
+  return static_cast<intmax_t>(sum);
+}
+
+inline __int128 scanChunkChecked(const intmax_t *values, std::size_t size,
+                                 __int128 carry, intmax_t *out) {
+  for (std::size_t i = 0; i < size; ++i) {
+    carry += values[i];
+    out[i] = checkedValue(carry);
+  }
+  return carry;
+}
+
+/*
+ * Two passes over chunks sized for the cache: the sums of the chunks,
+ * then the scan of each chunk from the sum of the previous ones
+ */
+inline void scan(const intmax_t *values, std::size_t size, intmax_t init,
+                 bool exclusive, ScanOverflow overflow, intmax_t *out,
+                 ThreadPool &pool) {
+  const std::size_t chunk = cacheChunk();
+  const std::size_t chunks = chunkCount(size);
+
+  std::vector<__int128> offsets(chunks + 1, 0);
+  offsets[0] = init;
+  parallelChunks(pool, chunks, [&](std::size_t i) {
+    std::size_t end = (i + 1) * chunk;
+    end = (end < size) ? end : size;
+    __int128 sum = 0;
+    for (std::size_t j = i * chunk; j < end; ++j) {
+      sum += values[j];
+    }
+    offsets[i + 1] = sum;
+  });
+  for (std::size_t i = 1; i <= chunks; ++i) {
+    offsets[i] += offsets[i - 1];
+  }
+
+  parallelChunks(pool, chunks, [&](std::size_t i) {
+    std::size_t begin = i * chunk;
+    std::size_t end = (begin + chunk < size) ? begin + chunk : size;
+    const intmax_t *in = values + begin;
+    intmax_t *res = out + begin;
+    std::size_t length = end - begin;
+    if (exclusive) {
+      res[0] = (overflow == ScanOverflow::Check)
+                   ? checkedValue(offsets[i])
+                   : static_cast<intmax_t>(offsets[i]);
+      ++res;
+      --length;
+    }
+    if (overflow == ScanOverflow::Check) {
+      scanChunkChecked(in, length, offsets[i], res);
+    } else {
+      scanChunk(in, length, static_cast<intmax_t>(offsets[i]), res);
+    }
+  });
+}
+
+} // namespace internal
+
+/*
+ * The running sums of a column, in its unit and ratio: cumulative
+ * distance from steps, cumulative charge from charges...
+ */
+template <class Q>
+QtyVector<typename QtySpan<Q>::Quantity>
+inclusive_scan(QtySpan<Q> column, ScanOverflow overflow = ScanOverflow::Wrap,
+               ThreadPool &pool = ThreadPool::global()) {
+  using Quantity = typename QtySpan<Q>::Quantity;
+  QtyVector<Quantity> res(column.size(), Quantity(0));
+  internal::scan(column.values(), column.size(), 0, false, overflow,
+                 QtySpan<Quantity>(res).values(), pool);
+  return res;
+}
+
+/*
+ * The sums of init and of the values before each value of a column
+ */
+template <class Q, class R>
+QtyVector<typename QtySpan<Q>::Quantity>
+exclusive_scan(QtySpan<Q> column, Qty<typename QtySpan<Q>::Unit, R> init,
+               ScanOverflow overflow = ScanOverflow::Wrap,
+               ThreadPool &pool = ThreadPool::global()) {
+  using Quantity = typename QtySpan<Q>::Quantity;
+  QtyVector<Quantity> res(column.size(), Quantity(0));
+  internal::scan(column.values(), column.size(),
+                 internal::exactValue<typename Quantity::Ratio>(init), true,
+                 overflow, QtySpan<Quantity>(res).values(), pool);
+  return res;
+}
+
+} // namespace phy
+
+#endif // SCAN_H
@@ -0,0 +1,96 @@
+#ifndef SHARDED_QTY_H
+#define SHARDED_QTY_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <ratio>
+#include <thread>
+
+#include "AtomicQty.h"
+#include "Units.h"
+
+namespace phy {
+
+namespace internal {
+
+/*
+ * A small identifier given to each thread on its first use
+ */
+inline std::size_t threadIndex() {
+  static std::atomic<std::size_t> next(0);
+  thread_local std::size_t index = next.fetch_add(1, std::memory_order_relaxed);
+  return index;
+}
+
+} // namespace internal
+
+/*
+ * A quantity accumulated in one cache line per thread and merged on read.
+ * Each thread updates its own slot, so the cache line never bounces
+ * between cores; the relaxed atomic add only keeps the sum exact when
+ * more threads than slots share one.
+ */
+template <class U, class R = std::ratio<1>> class ShardedQty {
+public:
+  using Quantity = Qty<U, R>;
+
+  explicit ShardedQty(std::size_t shards = defaultShards())
+      : count(shards == 0 ? 1 : shards), slots(new Slot[count]) {}
+
+  ShardedQty(const ShardedQty &) = delete;
+  ShardedQty &operator=(const ShardedQty &) = delete;
+
+  std::size_t shards() const { return count; }
+
+  template <typename ROther> void add(Qty<U, ROther> q) {
+    local().fetch_add(internal::exactValue<R>(q), std::memory_order_relaxed);
+  }
+
+  template <typename ROther> void sub(Qty<U, ROther> q) {
+    local().fetch_sub(internal::exactValue<R>(q), std::memory_order_relaxed);
+  }
+
+  /*
+   * The sum of all slots, concurrent updates may or may not be included
+   */
+  Quantity read() const {
+    intmax_t sum = 0;
+    for (std::size_t i = 0; i < count; ++i) {
+      sum += slots[i].value.load(std::memory_order_relaxed);
+    }
+    return Quantity(sum);
+  }
+
+  /*
+   * Returns the sum and sets all the slots to zero
+   */
+  Quantity reset() {
+    intmax_t sum = 0;
+    for (std::size_t i = 0; i < count; ++i) {
+      sum += slots[i].value.exchange(0, std::memory_order_relaxed);
+    }
+    return Quantity(sum);
+  }
+
+private:
+  struct alignas(64) Slot {
+    std::atomic<intmax_t> value{0};
+  };
+
+  static std::size_t defaultShards() {
+    return std::thread::hardware_concurrency();
+  }
+
+  std::atomic<intmax_t> &local() {
+    return slots[internal::threadIndex() % count].value;
+  }
+
+  std::size_t count;
+  std::unique_ptr<Slot[]> slots;
+};
+
+} // namespace phy
+
+#endif // SHARDED_QTY_H
@@ -0,0 +1,237 @@
+#ifndef SHARED_RING_H
+#define SHARED_RING_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "ColumnFile.h"
+#include "QtySpan.h"
+#include "Units.h"
+
+namespace phy {
+
+/*
+ * The header of a ring in shared memory, followed by its values.
+ * Producers reserve up to reserved, publish up to committed in order, and
+ * the consumer frees up to released.
+ */
+struct SharedRingHeader {
+  static constexpr uint32_t Version = 1;
+
+  char magic[4];
+  uint32_t version;
+  uint64_t capacity;
+  ColumnSchema schema;
+  alignas(64) std::atomic<uint64_t> reserved;
+  alignas(64) std::atomic<uint64_t> committed;
+  alignas(64) std::atomic<uint64_t> released;
+};
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free,
+              "the ring is shared between processes");
+
+/*
+ * A lock-free ring of quantities Q in a POSIX shared memory object, for
+ * batches exchanged between processes without copy: producers fill the
+ * spans they reserve in place, the single consumer reads the committed
+ * spans in place. Any number of producers may share the ring.
+ */
+template <class Q> class SharedRing {
+public:
+  /*
+   * Creates the shared memory object name with room for capacity values,
+   * rounded up to a power of two
+   */
+  static SharedRing create(const std::string &name, std::size_t capacity) {
+    const std::size_t largest =
+        (SIZE_MAX - sizeof(SharedRingHeader)) / sizeof(intmax_t) / 2;
+    if (capacity > largest) {
+      throw std::invalid_argument("SharedRing: capacity too large");
+    }
+    std::size_t size = 1;
+    while (size < capacity) {
+      size <<= 1;
+    }
+    int fd = ::shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+    if (fd < 0) {
+      throw std::runtime_error("SharedRing: cannot create " + name);
+    }
+    std::size_t length = sizeof(SharedRingHeader) + size * sizeof(intmax_t);
+    if (::ftruncate(fd, static_cast<off_t>(length)) != 0) {
+      ::close(fd);
+      ::shm_unlink(name.c_str());
+      throw std::runtime_error("SharedRing: cannot resize " + name);
+    }
+    SharedRing res(fd, length, name);
+
+    auto header = new (res.header) SharedRingHeader{};
+    header->version = SharedRingHeader::Version;
+    header->capacity = size;
+    header->schema = ColumnSchema::of<Q>();
+    std::atomic_thread_fence(std::memory_order_release);
+    std::memcpy(header->magic, "PHYR", 4);
+    return res;
+  }
+
+  /*
+   * Attaches to the ring name, which must hold quantities Q
+   */
+  static SharedRing attach(const std::string &name) {
+    int fd = ::shm_open(name.c_str(), O_RDWR, 0);
+    if (fd < 0) {
+      throw std::runtime_error("SharedRing: cannot open " + name);
+    }
+    struct stat info;
+    if (::fstat(fd, &info) != 0 ||
+        static_cast<std::size_t>(info.st_size) < sizeof(SharedRingHeader)) {
+      ::close(fd);
+      throw std::runtime_error("SharedRing: " + name + " is not a ring");
+    }
+    SharedRing res(fd, info.st_size, name);
+    std::atomic_thread_fence(std::memory_order_acquire);
+    const uint64_t capacity = res.header->capacity;
+    if (std::memcmp(res.header->magic, "PHYR", 4) != 0 ||
+        res.header->version != SharedRingHeader::Version || capacity == 0 ||
+        (capacity & (capacity - 1)) != 0 ||
+        capacity > (res.length - sizeof(SharedRingHeader)) / sizeof(intmax_t)) {
+      throw std::runtime_error("SharedRing: " + name + " is not a ring");
+    }
+    if (res.header->schema != ColumnSchema::of<Q>()) {
+      throw std::runtime_error("SharedRing: " + name +
+                               " does not hold the requested quantity");
+    }
+    return res;
+  }
+
+  /*
+   * Removes the shared memory object name, the attached rings stay usable
+   */
+  static void unlink(const std::string &name) { ::shm_unlink(name.c_str()); }
+
+  SharedRing(SharedRing &&other) noexcept
+      : header(std::exchange(other.header, nullptr)),
+        length(std::exchange(other.length, 0)) {}
+
+  SharedRing(const SharedRing &) = delete;
+  SharedRing &operator=(const SharedRing &) = delete;
+  SharedRing &operator=(SharedRing &&) = delete;
+
+  ~SharedRing() {
+    if (header != nullptr) {
+      ::munmap(header, length);
+    }
+  }
+
+  std::size_t capacity() const { return header->capacity; }
+
+  /*
+   * Reserves up to n contiguous free values, fewer at the end of the
+   * buffer or when the ring is nearly full
+   */
+  QtySpan<Q> reserve(std::size_t n) {
+    const uint64_t mask = header->capacity - 1;
+    uint64_t start = header->reserved.load(std::memory_order_relaxed);
+    std::size_t take;
+    do {
+      uint64_t released = header->released.load(std::memory_order_acquire);
+      std::size_t available = header->capacity - (start - released);
+      std::size_t contiguous = header->capacity - (start & mask);
+      take = (n < available) ? n : available;
+      take = (take < contiguous) ? take : contiguous;
+      if (take == 0) {
+        return QtySpan<Q>();
+      }
+    } while (!header->reserved.compare_exchange_weak(
+        start, start + take, std::memory_order_relaxed));
+    return QtySpan<Q>(values() + (start & mask), take);
+  }
+
+  /*
+   * Publishes a reserved span, once the spans reserved before it are
+   */
+  void commit(QtySpan<Q> span) {
+    if (span.empty()) {
+      return;
+    }
+    const uint64_t offset = span.data() - values();
+    const uint64_t mask = header->capacity - 1;
+    uint64_t committed = header->committed.load(std::memory_order_relaxed);
+    for (unsigned spins = 0; (committed & mask) != offset; ++spins) {
+      /*
+       * The earlier spans are being written: pause briefly, then leave
+       * the core to their producers
+       */
+      if (spins < 64) {
+#if defined(__SSE2__)
+        _mm_pause();
+#endif
+      } else {
+        std::this_thread::yield();
+      }
+      committed = header->committed.load(std::memory_order_relaxed);
+    }
+    header->committed.store(committed + span.size(),
+                            std::memory_order_release);
+  }
+
+  /*
+   * The contiguous committed values not yet released, at most n
+   */
+  QtySpan<const Q> read(std::size_t n = SIZE_MAX) const {
+    const uint64_t mask = header->capacity - 1;
+    uint64_t start = header->released.load(std::memory_order_relaxed);
+    uint64_t committed = header->committed.load(std::memory_order_acquire);
+    std::size_t available = committed - start;
+    std::size_t contiguous = header->capacity - (start & mask);
+    std::size_t take = (n < available) ? n : available;
+    take = (take < contiguous) ? take : contiguous;
+    return QtySpan<const Q>(values() + (start & mask), take);
+  }
+
+  /*
+   * Frees the n first values returned by read
+   */
+  void release(std::size_t n) {
+    header->released.fetch_add(n, std::memory_order_release);
+  }
+
+private:
+  SharedRing(int fd, std::size_t size, const std::string &name)
+      : header(nullptr), length(size) {
+    void *res =
+        ::mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (res == MAP_FAILED) {
+      throw std::runtime_error("SharedRing: cannot map " + name);
+    }
+    header = static_cast<SharedRingHeader *>(res);
+  }
+
+  Q *values() const {
+    return reinterpret_cast<Q *>(reinterpret_cast<char *>(header) +
+                                 sizeof(SharedRingHeader));
+  }
+
+  SharedRingHeader *header;
+  std::size_t length;
+};
+
+} // namespace phy
+
+#endif // SHARED_RING_H
@@ -0,0 +1,155 @@
+#ifndef SPSC_QUEUE_H
+#define SPSC_QUEUE_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <ratio>
+#include <vector>
+
+#include "AtomicQty.h"
+#include "QtySpan.h"
+#include "Units.h"
+
+namespace phy {
+
+/*
+ * A bounded lock-free queue of quantities between one producer thread and
+ * one consumer thread. The positions of each side live in their own cache
+ * line, along with a cached copy of the position of the other side, so
+ * that the cache lines only move when a side runs out of room or values.
+ *
+ * The batch interface hands out contiguous spans of the buffer: the
+ * producer fills the span of reserve() then commits it, the consumer
+ * reads the span of front() then pops it.
+ */
+template <class U, class R = std::ratio<1>> class SpscQueue {
+public:
+  using Quantity = Qty<U, R>;
+
+  /*
+   * capacity is rounded up to a power of two
+   */
+  explicit SpscQueue(std::size_t capacity)
+      : mask(roundUp(capacity) - 1), buffer(mask + 1, Quantity(0)) {}
+
+  SpscQueue(const SpscQueue &) = delete;
+  SpscQueue &operator=(const SpscQueue &) = delete;
+
+  std::size_t capacity() const { return mask + 1; }
+
+  template <typename ROther> bool tryPush(Qty<U, ROther> q) {
+    QtySpan<Quantity> span = reserve(1);
+    if (span.empty()) {
+      return false;
+    }
+    span[0] = Quantity(internal::exactValue<R>(q));
+    commit(1);
+    return true;
+  }
+
+  bool tryPop(Quantity &q) {
+    QtySpan<const Quantity> span = front(1);
+    if (span.empty()) {
+      return false;
+    }
+    q = span[0];
+    pop(1);
+    return true;
+  }
+
+  /*
+   * Copies as many values of values as there is room for, returns how many
+   */
+  std::size_t push(QtySpan<const Quantity> values) {
+    std::size_t pushed = 0;
+    while (pushed < values.size()) {
+      QtySpan<Quantity> span = reserve(values.size() - pushed);
+      if (span.empty()) {
+        break;
+      }
+      for (std::size_t i = 0; i < span.size(); ++i) {
+        span[i] = values[pushed + i];
+      }
+      commit(span.size());
+      pushed += span.size();
+    }
+    return pushed;
+  }
+
+  /*
+   * Up to n contiguous free slots, for the producer
+   */
+  QtySpan<Quantity> reserve(std::size_t n) {
+    const std::size_t tail = producer.position.load(std::memory_order_relaxed);
+    if (n > capacity() - (tail - producer.cached)) {
+      producer.cached = consumer.position.load(std::memory_order_acquire);
+    }
+    return QtySpan<Quantity>(buffer.data() + (tail & mask),
+                             clamp(n, capacity() - (tail - producer.cached),
+                                   tail));
+  }
+
+  /*
+   * Publishes the n first values of the span of reserve()
+   */
+  void commit(std::size_t n) {
+    producer.position.store(
+        producer.position.load(std::memory_order_relaxed) + n,
+        std::memory_order_release);
+  }
+
+  /*
+   * Up to n contiguous values, for the consumer
+   */
+  QtySpan<const Quantity> front(std::size_t n = SIZE_MAX) {
+    const std::size_t head = consumer.position.load(std::memory_order_relaxed);
+    if (consumer.cached - head < n) {
+      consumer.cached = producer.position.load(std::memory_order_acquire);
+    }
+    return QtySpan<const Quantity>(buffer.data() + (head & mask),
+                                   clamp(n, consumer.cached - head, head));
+  }
+
+  /*
+   * Frees the n first values of the span of front()
+   */
+  void pop(std::size_t n) {
+    consumer.position.store(
+        consumer.position.load(std::memory_order_relaxed) + n,
+        std::memory_order_release);
+  }
+
+private:
+  static std::size_t roundUp(std::size_t capacity) {
+    std::size_t res = 1;
+    while (res < capacity) {
+      res <<= 1;
+    }
+    return res;
+  }
+
+  /*
+   * n limited to the available slots and to the end of the buffer
+   */
+  std::size_t clamp(std::size_t n, std::size_t available,
+                    std::size_t position) const {
+    std::size_t contiguous = capacity() - (position & mask);
+    n = (n < available) ? n : available;
+    return (n < contiguous) ? n : contiguous;
+  }
+
+  struct alignas(64) Side {
+    std::atomic<std::size_t> position{0};
+    std::size_t cached = 0; // last seen position of the other side
+  };
+
+  Side producer;
+  Side consumer;
+  const std::size_t mask;
+  std::vector<Quantity> buffer;
+};
+
+} // namespace phy
+
+#endif // SPSC_QUEUE_H
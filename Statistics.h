@@ -0,0 +1,201 @@
+#ifndef STATISTICS_H
+#define STATISTICS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <ratio>
+#include <stdexcept>
+#include <type_traits>
+
+#include "QtySpan.h"
+#include "Units.h"
+
+namespace phy {
+
+namespace internal {
+
+inline __int128 statisticsAdd(__int128 a, __int128 b) {
+  __int128 res;
+  if (__builtin_add_overflow(a, b, &res)) {
+    throw std::overflow_error("Statistics: sums out of range");
+  }
+  return res;
+}
+
+inline __int128 statisticsMultiply(__int128 a, __int128 b) {
+  __int128 res;
+  if (__builtin_mul_overflow(a, b, &res)) {
+    throw std::overflow_error("Statistics: sums out of range");
+  }
+  return res;
+}
+
+/*
+ * a / b rounded to the nearest integer, halves away from zero, for b > 0
+ */
+inline __int128 roundedDivide(__int128 a, __int128 b) {
+  __int128 q = a / b;
+  __int128 r = a % b;
+  if (r >= b - r) {
+    ++q;
+  } else if (-r >= b + r) {
+    --q;
+  }
+  return q;
+}
+
+} // namespace internal
+
+/*
+ * Online statistics of a stream of quantities: count, min, max, mean and
+ * variance. The values are accumulated exactly on 128 bits relative to the
+ * first one (shifted sums, so that timestamps do not square their epoch),
+ * the mean and the variance are rounded once when they are read. Partial
+ * statistics, for example one per thread, are combined exactly with
+ * merge(). Throws std::overflow_error if the sums do not fit on 128 bits.
+ */
+template <class Q> class Statistics;
+
+template <class U, class R> class Statistics<Qty<U, R>> {
+public:
+  using Quantity = Qty<U, R>;
+  using Variance = Qty<MultiReturnUnit<U, U>, std::ratio_multiply<R, R>>;
+
+  Statistics()
+      : n(0), shift(0), sum(0), squares(0),
+        lowest(std::numeric_limits<intmax_t>::max()),
+        highest(std::numeric_limits<intmax_t>::min()) {}
+
+  void add(Quantity q) {
+    if (n == 0) {
+      shift = q.value;
+    }
+    ++n;
+    __int128 d = static_cast<__int128>(q.value) - shift;
+    sum += d;
+    squares = internal::statisticsAdd(squares,
+                                      internal::statisticsMultiply(d, d));
+    lowest = (q.value < lowest) ? q.value : lowest;
+    highest = (q.value > highest) ? q.value : highest;
+  }
+
+  /*
+   * Batch update: the shifted sums, min and max are computed in one pass,
+   * then the batch is merged
+   */
+  template <typename Q> void add(QtySpan<Q> column) {
+    static_assert(std::is_same<typename QtySpan<Q>::Quantity, Quantity>::value,
+                  "the column must have the type of the statistics");
+    if (column.empty()) {
+      return;
+    }
+
+    const intmax_t *values = column.values();
+    const std::size_t size = column.size();
+
+    Statistics batch;
+    batch.n = size;
+    batch.shift = values[0];
+    for (std::size_t i = 0; i < size; ++i) {
+      __int128 d = static_cast<__int128>(values[i]) - batch.shift;
+      batch.sum += d;
+      batch.squares = internal::statisticsAdd(
+          batch.squares, internal::statisticsMultiply(d, d));
+      batch.lowest = (values[i] < batch.lowest) ? values[i] : batch.lowest;
+      batch.highest = (values[i] > batch.highest) ? values[i] : batch.highest;
+    }
+
+    merge(batch);
+  }
+
+  /*
+   * The sums of other are shifted to the first value of this one:
+   * sum (x - a)^2 = sum (x - b)^2 + 2 (b - a) sum (x - b) + n (b - a)^2
+   */
+  void merge(const Statistics &other) {
+    if (other.n == 0) {
+      return;
+    }
+    if (n == 0) {
+      *this = other;
+      return;
+    }
+    using internal::statisticsAdd;
+    using internal::statisticsMultiply;
+    const __int128 d = static_cast<__int128>(other.shift) - shift;
+    const __int128 count = static_cast<__int128>(other.n);
+    __int128 shiftedSquares = statisticsAdd(
+        other.squares, statisticsMultiply(2 * d, other.sum));
+    shiftedSquares = statisticsAdd(
+        shiftedSquares, statisticsMultiply(count, statisticsMultiply(d, d)));
+    squares = statisticsAdd(squares, shiftedSquares);
+    sum = statisticsAdd(sum, statisticsAdd(other.sum,
+                                           statisticsMultiply(count, d)));
+    n += other.n;
+    lowest = (other.lowest < lowest) ? other.lowest : lowest;
+    highest = (other.highest > highest) ? other.highest : highest;
+  }
+
+  uint64_t count() const { return n; }
+
+  Quantity min() const { return Quantity(n == 0 ? 0 : lowest); }
+  Quantity max() const { return Quantity(n == 0 ? 0 : highest); }
+
+  /*
+   * The mean and the (population) variance, rounded to the nearest value.
+   * variance() throws std::overflow_error if it does not fit in the
+   * representation.
+   */
+  Quantity mean() const {
+    if (n == 0) {
+      return Quantity(0);
+    }
+    return Quantity(static_cast<intmax_t>(
+        shift + internal::roundedDivide(sum, static_cast<__int128>(n))));
+  }
+
+  /*
+   * With sum = q n + r, the sum of the squared deviations is
+   * squares - sum^2 / n = a - r^2 / n with a = squares - q^2 n - 2 q r,
+   * which avoids squaring the sum
+   */
+  Variance variance() const {
+    if (n == 0) {
+      return Variance(0);
+    }
+    const __int128 count = static_cast<__int128>(n);
+    const __int128 q = sum / count;
+    const __int128 r = sum % count;
+    const __int128 a = squares - q * q * count - 2 * q * r;
+
+    /*
+     * (a - r^2 / n) / n = a / n + (a % n * n - r^2) / n^2, whose fraction
+     * is in (-1, 1)
+     */
+    __int128 res = a / count;
+    const __int128 fraction = (a % count) * count - r * r;
+    const __int128 square = count * count;
+    if (fraction >= square - fraction) {
+      ++res;
+    } else if (-fraction > square + fraction) {
+      --res;
+    }
+    if (res > INTMAX_MAX) {
+      throw std::overflow_error("Statistics: variance out of range");
+    }
+    return Variance(static_cast<intmax_t>(res));
+  }
+
+private:
+  uint64_t n;
+  intmax_t shift;
+  __int128 sum;
+  __int128 squares;
+  intmax_t lowest;
+  intmax_t highest;
+};
+
+} // namespace phy
+
+#endif // STATISTICS_H
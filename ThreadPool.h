@@ -0,0 +1,235 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <unistd.h>
+
+namespace phy {
+
+/*
+ * A work-stealing pool: every worker has its own queue of tasks, runs the
+ * most recent task of its queue first and, when its queue is empty, steals
+ * the oldest task of another queue. A task submitted from a worker goes
+ * to the queue of this worker, the others are spread over the queues.
+ * The destructor runs the pending tasks before joining the workers.
+ */
+class ThreadPool {
+public:
+  explicit ThreadPool(std::size_t threads = defaultThreads())
+      : pending(0), next(0), stopping(false) {
+    threads = (threads == 0) ? 1 : threads;
+    for (std::size_t i = 0; i < threads; ++i) {
+      queues.emplace_back(new Queue);
+    }
+    for (std::size_t i = 0; i < threads; ++i) {
+      workers.emplace_back([this, i]() { run(i); });
+    }
+  }
+
+  ThreadPool(const ThreadPool &) = delete;
+  ThreadPool &operator=(const ThreadPool &) = delete;
+
+  ~ThreadPool() {
+    {
+      std::lock_guard<std::mutex> lock(sleepMutex);
+      stopping = true;
+    }
+    ready.notify_all();
+    for (auto &worker : workers) {
+      worker.join();
+    }
+  }
+
+  /*
+   * The pool shared by the pipelines and parallel algorithms by default
+   */
+  static ThreadPool &global() {
+    static ThreadPool pool;
+    return pool;
+  }
+
+  std::size_t size() const { return workers.size(); }
+
+  void submit(std::function<void()> task) {
+    Worker &self = current();
+    std::size_t index = (self.pool == this)
+                            ? self.index
+                            : next.fetch_add(1, std::memory_order_relaxed) %
+                                  queues.size();
+    pending.fetch_add(1, std::memory_order_relaxed);
+    {
+      std::lock_guard<std::mutex> lock(queues[index]->mutex);
+      queues[index]->tasks.push_back(std::move(task));
+    }
+    {
+      std::lock_guard<std::mutex> lock(sleepMutex);
+    }
+    ready.notify_one();
+  }
+
+private:
+  struct Queue {
+    std::mutex mutex;
+    std::deque<std::function<void()>> tasks;
+  };
+
+  /*
+   * The pool and the index of the worker running the calling thread
+   */
+  struct Worker {
+    ThreadPool *pool = nullptr;
+    std::size_t index = 0;
+  };
+
+  static Worker &current() {
+    thread_local Worker worker;
+    return worker;
+  }
+
+  static std::size_t defaultThreads() {
+    return std::thread::hardware_concurrency();
+  }
+
+  bool take(std::size_t index, std::function<void()> &task) {
+    {
+      Queue &own = *queues[index];
+      std::lock_guard<std::mutex> lock(own.mutex);
+      if (!own.tasks.empty()) {
+        task = std::move(own.tasks.back());
+        own.tasks.pop_back();
+        return true;
+      }
+    }
+    for (std::size_t i = 1; i < queues.size(); ++i) {
+      Queue &victim = *queues[(index + i) % queues.size()];
+      std::lock_guard<std::mutex> lock(victim.mutex);
+      if (!victim.tasks.empty()) {
+        task = std::move(victim.tasks.front());
+        victim.tasks.pop_front();
+        return true;
+      }
+    }
+    return false;
+  }
+
+  void run(std::size_t index) {
+    current() = Worker{this, index};
+    for (;;) {
+      std::function<void()> task;
+      if (take(index, task)) {
+        pending.fetch_sub(1, std::memory_order_relaxed);
+        task();
+        continue;
+      }
+      std::unique_lock<std::mutex> lock(sleepMutex);
+      ready.wait(lock, [this]() {
+        return stopping || pending.load(std::memory_order_relaxed) > 0;
+      });
+      if (stopping && pending.load(std::memory_order_relaxed) == 0) {
+        return;
+      }
+    }
+  }
+
+  std::vector<std::unique_ptr<Queue>> queues;
+  std::atomic<std::size_t> pending;
+  std::atomic<std::size_t> next;
+  std::mutex sleepMutex;
+  std::condition_variable ready;
+  bool stopping;
+  std::vector<std::thread> workers;
+};
+
+namespace internal {
+
+/*
+ * The number of values of a chunk, so that a chunk read and a chunk
+ * written fit in the L2 cache together
+ */
+inline std::size_t cacheChunk() {
+  static const std::size_t chunk = []() {
+    long cache = ::sysconf(_SC_LEVEL2_CACHE_SIZE);
+    std::size_t bytes = (cache > 0) ? cache : 256 * 1024;
+    std::size_t values = bytes / (2 * sizeof(intmax_t));
+    return (values < 1024) ? std::size_t(1024) : values;
+  }();
+  return chunk;
+}
+
+inline std::size_t chunkCount(std::size_t size) {
+  return (size + cacheChunk() - 1) / cacheChunk();
+}
+
+/*
+ * Runs body(i) for every chunk i of [0, chunks). The calling thread and one
+ * task per worker claim the chunks in turn, so that the fastest threads
+ * take the most chunks; calling from a task of the pool is allowed.
+ */
+template <class Body>
+void parallelChunks(ThreadPool &pool, std::size_t chunks, const Body &body) {
+  if (chunks <= 1) {
+    if (chunks == 1) {
+      body(0);
+    }
+    return;
+  }
+
+  struct Shared {
+    std::atomic<std::size_t> next{0};
+    std::atomic<std::size_t> finished{0};
+    std::mutex mutex;
+    std::condition_variable done;
+    std::exception_ptr error;
+  };
+  auto shared = std::make_shared<Shared>();
+
+  /*
+   * A helper starting after the last chunk was claimed does not touch body
+   */
+  auto work = [shared, chunks, &body]() {
+    for (std::size_t i; (i = shared->next.fetch_add(1)) < chunks;) {
+      try {
+        body(i);
+      } catch (...) {
+        std::lock_guard<std::mutex> lock(shared->mutex);
+        if (!shared->error) {
+          shared->error = std::current_exception();
+        }
+      }
+      if (shared->finished.fetch_add(1) + 1 == chunks) {
+        std::lock_guard<std::mutex> lock(shared->mutex);
+        shared->done.notify_all();
+      }
+    }
+  };
+
+  std::size_t helpers = (pool.size() < chunks - 1) ? pool.size() : chunks - 1;
+  for (std::size_t i = 0; i < helpers; ++i) {
+    pool.submit(work);
+  }
+  work();
+
+  std::unique_lock<std::mutex> lock(shared->mutex);
+  shared->done.wait(lock, [&]() { return shared->finished == chunks; });
+  if (shared->error) {
+    std::rethrow_exception(shared->error);
+  }
+}
+
+} // namespace internal
+
+} // namespace phy
+
+#endif // THREAD_POOL_H
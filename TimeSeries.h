@@ -0,0 +1,378 @@
+#ifndef TIME_SERIES_H
+#define TIME_SERIES_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <limits>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "ColumnFile.h"
+#include "MappedFile.h"
+#include "QtySpan.h"
+#include "Units.h"
+
+namespace phy {
+
+/*
+ * The header of a segment of a time series, followed by the schemas of its
+ * columns, the sparse index of its timestamps and its columns.
+ * The timestamp of every IndexStride-th row is in the index.
+ */
+struct SegmentHeader {
+  static constexpr uint32_t Version = 1;
+
+  char magic[4];
+  uint32_t version;
+  uint64_t capacity;
+  uint64_t committed; // published by the writer with a release store
+  uint32_t columns;
+  uint32_t indexStride;
+  uint64_t reserved[4];
+};
+
+static_assert(sizeof(SegmentHeader) == ColumnHeader::Alignment,
+              "SegmentHeader is an on-disk record");
+
+namespace internal {
+
+inline std::size_t alignColumn(std::size_t offset) {
+  return (offset + ColumnHeader::Alignment - 1) / ColumnHeader::Alignment *
+         ColumnHeader::Alignment;
+}
+
+/*
+ * The offsets of the parts of a segment
+ */
+struct SegmentLayout {
+  SegmentLayout(std::size_t columns, std::size_t capacity, std::size_t stride)
+      : schemas(sizeof(SegmentHeader)),
+        index(alignColumn(schemas + columns * sizeof(ColumnSchema))),
+        data(alignColumn(index + (capacity + stride - 1) / stride *
+                                     sizeof(intmax_t))),
+        column(alignColumn(capacity * sizeof(intmax_t))),
+        size(data + columns * column) {}
+
+  std::size_t schemas;
+  std::size_t index;
+  std::size_t data;
+  std::size_t column; // size of a column
+  std::size_t size;
+};
+
+inline std::string segmentPath(const std::string &directory,
+                               std::size_t segment) {
+  char name[32];
+  std::snprintf(name, sizeof(name), "segment-%06zu.phy", segment);
+  return (std::filesystem::path(directory) / name).string();
+}
+
+template <class Time, class... Qs> std::vector<ColumnSchema> seriesSchemas() {
+  return {ColumnSchema::of<Time>(), ColumnSchema::of<Qs>()...};
+}
+
+/*
+ * The header of a mapped segment, checked against the expected schemas.
+ * The capacity is bounded by the size of the file before the layout is
+ * computed, so that a forged capacity cannot overflow it.
+ */
+inline SegmentHeader *segmentHeader(const MappedFile &file,
+                                    const std::vector<ColumnSchema> &schemas,
+                                    const std::string &path) {
+  auto header = reinterpret_cast<SegmentHeader *>(file.writableData());
+  if (file.size() < sizeof(SegmentHeader) ||
+      std::memcmp(header->magic, "PHYS", 4) != 0 ||
+      header->version != SegmentHeader::Version ||
+      header->columns != schemas.size() || header->indexStride == 0) {
+    throw std::runtime_error("TimeSeries: " + path + " is not a segment");
+  }
+  if (header->capacity > file.size() / sizeof(intmax_t) / header->columns ||
+      header->committed > header->capacity) {
+    throw std::runtime_error("TimeSeries: " + path + " is invalid");
+  }
+  SegmentLayout layout(header->columns, header->capacity, header->indexStride);
+  auto stored =
+      reinterpret_cast<const ColumnSchema *>(file.data() + layout.schemas);
+  if (file.size() < layout.size ||
+      !std::equal(schemas.begin(), schemas.end(), stored)) {
+    throw std::runtime_error("TimeSeries: " + path +
+                             " does not hold the requested columns");
+  }
+  return header;
+}
+
+} // namespace internal
+
+/*
+ * The writer of an append-only time series stored in a directory of
+ * segments of capacity rows, with one column of timestamps of type Time
+ * and one column per quantity of Qs. There must be a single writer per
+ * directory; appending never blocks the readers.
+ */
+template <class Time, class... Qs> class TimeSeriesWriter {
+  static_assert(std::is_same<typename Time::Unit, Second>::value,
+                "the timestamps must be times");
+
+public:
+  static constexpr std::size_t Columns = 1 + sizeof...(Qs);
+
+  /*
+   * Resumes the last segment of directory if there is one. Throws
+   * std::invalid_argument if capacity or indexStride is 0 or too large.
+   */
+  explicit TimeSeriesWriter(const std::string &directory,
+                            std::size_t capacity = 1 << 20,
+                            std::size_t indexStride = 1024)
+      : directory(directory), capacity(capacity), indexStride(indexStride),
+        segment(0), count(0), last(std::numeric_limits<intmax_t>::min()) {
+    if (capacity == 0 || indexStride == 0 || indexStride > UINT32_MAX ||
+        capacity > SIZE_MAX / sizeof(intmax_t) / (Columns + 1) / 2) {
+      throw std::invalid_argument("TimeSeriesWriter: invalid capacity or "
+                                  "index stride");
+    }
+    std::filesystem::create_directories(directory);
+    while (std::filesystem::exists(internal::segmentPath(directory, segment))) {
+      ++segment;
+    }
+    if (segment > 0) {
+      open(--segment);
+    }
+  }
+
+  /*
+   * Appends a row whose timestamp is not earlier than the previous one
+   */
+  void append(Time time, Qs... values) {
+    if (time.value < last) {
+      throw std::invalid_argument("TimeSeriesWriter: timestamps must not "
+                                  "decrease");
+    }
+    if (!file || count == header->capacity) {
+      create(file ? segment + 1 : segment);
+    }
+
+    const intmax_t row[] = {time.value, values.value...};
+    for (std::size_t i = 0; i < Columns; ++i) {
+      columns[i][count] = row[i];
+    }
+    if (count % header->indexStride == 0) {
+      index[count / header->indexStride] = time.value;
+    }
+    last = time.value;
+    __atomic_store_n(&header->committed, ++count, __ATOMIC_RELEASE);
+  }
+
+  std::size_t segments() const { return file ? segment + 1 : 0; }
+
+private:
+  /*
+   * Maps the segment and locates its columns once
+   */
+  void open(std::size_t id) {
+    std::string path = internal::segmentPath(directory, id);
+    file.emplace(path, MapMode::ReadWrite);
+    header = internal::segmentHeader(
+        *file, internal::seriesSchemas<Time, Qs...>(), path);
+    internal::SegmentLayout layout(Columns, header->capacity,
+                                   header->indexStride);
+    for (std::size_t i = 0; i < Columns; ++i) {
+      columns[i] = reinterpret_cast<intmax_t *>(
+          file->writableData() + layout.data + i * layout.column);
+    }
+    index = reinterpret_cast<intmax_t *>(file->writableData() + layout.index);
+    segment = id;
+    count = header->committed;
+    if (count > 0) {
+      last = columns[0][count - 1];
+    }
+  }
+
+  /*
+   * Segments are initialised under a temporary name so that readers
+   * only ever see complete headers
+   */
+  void create(std::size_t id) {
+    std::string path = internal::segmentPath(directory, id);
+    internal::SegmentLayout layout(Columns, capacity, indexStride);
+    std::filesystem::remove(path + ".tmp"); // left by an interrupted writer
+    {
+      MappedFile created(path + ".tmp", layout.size);
+      SegmentHeader init{};
+      std::memcpy(init.magic, "PHYS", 4);
+      init.version = SegmentHeader::Version;
+      init.capacity = capacity;
+      init.columns = Columns;
+      init.indexStride = static_cast<uint32_t>(indexStride);
+      std::memcpy(created.writableData(), &init, sizeof(init));
+      auto schemas = internal::seriesSchemas<Time, Qs...>();
+      std::memcpy(created.writableData() + layout.schemas, schemas.data(),
+                  schemas.size() * sizeof(ColumnSchema));
+    }
+    if (std::rename((path + ".tmp").c_str(), path.c_str()) != 0) {
+      throw std::runtime_error("TimeSeriesWriter: cannot create " + path);
+    }
+    file.reset();
+    open(id);
+  }
+
+  std::string directory;
+  std::size_t capacity;
+  std::size_t indexStride;
+  std::size_t segment;
+  std::size_t count;
+  intmax_t last;
+  std::optional<MappedFile> file;
+  SegmentHeader *header = nullptr;
+  intmax_t *columns[Columns] = {};
+  intmax_t *index = nullptr;
+};
+
+/*
+ * The rows of a segment of a time series, used in place
+ */
+template <class Time, class... Qs> struct TimeSeriesSlice {
+  QtySpan<const Time> time;
+  std::tuple<QtySpan<const Qs>...> values;
+
+  std::size_t size() const { return time.size(); }
+};
+
+/*
+ * A reader of a time series written by a TimeSeriesWriter, possibly in
+ * another process: the rows committed by the writer are visible as soon
+ * as they are appended, without copy
+ */
+template <class Time, class... Qs> class TimeSeriesReader {
+public:
+  using Slice = TimeSeriesSlice<Time, Qs...>;
+  static constexpr std::size_t Columns = 1 + sizeof...(Qs);
+
+  explicit TimeSeriesReader(const std::string &directory)
+      : directory(directory) {
+    refresh();
+  }
+
+  /*
+   * Maps the segments created since the last call
+   */
+  void refresh() {
+    std::string path;
+    while (std::filesystem::exists(
+        path = internal::segmentPath(directory, files.size()))) {
+      MappedFile file(path);
+      internal::segmentHeader(file, internal::seriesSchemas<Time, Qs...>(),
+                              path);
+      files.push_back(std::move(file));
+    }
+  }
+
+  std::size_t size() const {
+    std::size_t res = 0;
+    for (const MappedFile &file : files) {
+      res += committed(file);
+    }
+    return res;
+  }
+
+  /*
+   * The rows whose timestamp is in [from, to), one slice per segment
+   */
+  template <typename RFrom, typename RTo>
+  std::vector<Slice> range(Qty<Second, RFrom> from, Qty<Second, RTo> to) const {
+    const intmax_t lo = qtyCeilCast<Time>(from).value;
+    const intmax_t hi = qtyCeilCast<Time>(to).value;
+    std::vector<Slice> res;
+    for (const MappedFile &file : files) {
+      std::size_t count = committed(file);
+      if (count == 0) {
+        continue;
+      }
+      const intmax_t *time = column(file, 0);
+      if (time[0] >= hi) {
+        break;
+      }
+      if (time[count - 1] < lo) {
+        continue;
+      }
+      std::size_t begin = lowerBound(file, count, lo);
+      std::size_t end = lowerBound(file, count, hi);
+      if (begin < end) {
+        res.push_back(
+            slice(file, begin, end, std::index_sequence_for<Qs...>()));
+      }
+    }
+    return res;
+  }
+
+private:
+  /*
+   * Bounded by the capacity checked when the segment was mapped, should
+   * another process corrupt the header
+   */
+  static std::size_t committed(const MappedFile &file) {
+    auto header = reinterpret_cast<const SegmentHeader *>(file.data());
+    std::size_t res = __atomic_load_n(&header->committed, __ATOMIC_ACQUIRE);
+    return (res < header->capacity) ? res : header->capacity;
+  }
+
+  static internal::SegmentLayout layout(const MappedFile &file) {
+    auto header = reinterpret_cast<const SegmentHeader *>(file.data());
+    return internal::SegmentLayout(Columns, header->capacity,
+                                   header->indexStride);
+  }
+
+  static const intmax_t *column(const MappedFile &file, std::size_t i) {
+    internal::SegmentLayout parts = layout(file);
+    return reinterpret_cast<const intmax_t *>(file.data() + parts.data +
+                                              i * parts.column);
+  }
+
+  /*
+   * The first row of the count first rows whose timestamp is not less
+   * than t: the sparse index gives the stride, then the stride is searched
+   */
+  static std::size_t lowerBound(const MappedFile &file, std::size_t count,
+                                intmax_t t) {
+    auto header = reinterpret_cast<const SegmentHeader *>(file.data());
+    const std::size_t stride = header->indexStride;
+    const intmax_t *index =
+        reinterpret_cast<const intmax_t *>(file.data() + layout(file).index);
+    const intmax_t *entries = index + (count + stride - 1) / stride;
+    std::size_t block = std::lower_bound(index, entries, t) - index;
+    block = (block == 0) ? 0 : block - 1;
+
+    const intmax_t *time = column(file, 0);
+    std::size_t end = std::min(count, (block + 1) * stride);
+    const intmax_t *res =
+        std::lower_bound(time + block * stride, time + end, t);
+    return res - time;
+  }
+
+  template <std::size_t... Is>
+  static Slice slice(const MappedFile &file, std::size_t begin,
+                     std::size_t end, std::index_sequence<Is...>) {
+    return Slice{
+        QtySpan<const Time>(
+            reinterpret_cast<const Time *>(column(file, 0) + begin),
+            end - begin),
+        std::tuple<QtySpan<const Qs>...>(QtySpan<const Qs>(
+            reinterpret_cast<const Qs *>(column(file, Is + 1) + begin),
+            end - begin)...)};
+  }
+
+  std::string directory;
+  std::vector<MappedFile> files;
+};
+
+} // namespace phy
+
+#endif // TIME_SERIES_H
@@ -0,0 +1,259 @@
+#ifndef TIMER_WHEEL_H
+#define TIMER_WHEEL_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <ratio>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "Units.h"
+
+namespace phy {
+
+/*
+ * A hierarchical timer wheel: Levels wheels of 2^LevelBits slots, the slots
+ * of the level k lasting 2^(k * LevelBits) ticks of TickRatio seconds.
+ * Scheduling and cancelling are O(1); advancing moves the timers of a slot
+ * of an upper level down when the lower level wraps.
+ *
+ * Durations and deadlines are any Qty<Second, R>, converted to ticks with
+ * a factor folded at compile time, and rounded up so that a timer never
+ * fires early. The time of a wheel starts at a non-negative value and never
+ * goes back: a deadline in the past fires at the next tick. A wheel is not
+ * thread-safe: use one wheel per thread.
+ */
+template <class TickRatio = std::milli, int LevelBits = 8, int Levels = 4>
+class TimerWheel {
+  static_assert(LevelBits * Levels < 63, "the wheel is too large");
+
+public:
+  using Tick = Qty<Second, TickRatio>;
+  using Callback = std::function<void()>;
+
+  struct TimerId {
+    uint32_t index;
+    uint32_t generation;
+  };
+
+  /*
+   * Throws std::invalid_argument if start is negative
+   */
+  template <typename R = TickRatio>
+  explicit TimerWheel(Qty<Second, R> start = Qty<Second, R>(0))
+      : current(0), pending(0), heads(Levels * Slots, Nil),
+        levelSizes(Levels, 0), freeList(Nil) {
+    intmax_t ticks = qtyFloorCast<Tick>(start).value;
+    if (ticks < 0) {
+      throw std::invalid_argument("TimerWheel: negative start time");
+    }
+    current = static_cast<uint64_t>(ticks);
+  }
+
+  Tick now() const { return Tick(current); }
+  std::size_t size() const { return pending; }
+
+  /*
+   * Schedules callback after delay, a delay which is not positive fires at
+   * the next tick
+   */
+  template <typename R>
+  TimerId schedule(Qty<Second, R> delay, Callback callback) {
+    intmax_t ticks = qtyCeilCast<Tick>(delay).value;
+    return add(current + ((ticks > 0) ? static_cast<uint64_t>(ticks) : 0),
+               std::move(callback));
+  }
+
+  /*
+   * Schedules callback at deadline, on the time scale of now()
+   */
+  template <typename R>
+  TimerId scheduleAt(Qty<Second, R> deadline, Callback callback) {
+    intmax_t ticks = qtyCeilCast<Tick>(deadline).value;
+    return add((ticks > 0) ? static_cast<uint64_t>(ticks) : 0,
+               std::move(callback));
+  }
+
+  /*
+   * Returns false if the timer already fired or was cancelled
+   */
+  bool cancel(TimerId id) {
+    if (id.index >= nodes.size() ||
+        nodes[id.index].generation != id.generation ||
+        nodes[id.index].slot == Nil) {
+      return false;
+    }
+    unlink(id.index);
+    release(id.index);
+    return true;
+  }
+
+  /*
+   * Advances the wheel up to time and fires the expired timers,
+   * returns the number of fired timers. A time before now() does nothing.
+   */
+  template <typename R> std::size_t advanceTo(Qty<Second, R> time) {
+    const intmax_t ticks = qtyFloorCast<Tick>(time).value;
+    if (ticks < 0) {
+      return 0;
+    }
+    const uint64_t target = static_cast<uint64_t>(ticks);
+    std::size_t fired = 0;
+
+    while (current < target) {
+      if (pending == 0) {
+        current = target;
+        break;
+      }
+
+      /*
+       * Nothing to fire before the next boundary of the first level
+       */
+      if (levelSizes[0] == 0) {
+        uint64_t boundary = ((current >> LevelBits) + 1) << LevelBits;
+        current = ((boundary < target) ? boundary : target) - 1;
+      }
+      tick(current + 1, fired);
+    }
+    return fired;
+  }
+
+  template <typename R> std::size_t advance(Qty<Second, R> elapsed) {
+    return advanceTo(Tick(current) + elapsed);
+  }
+
+private:
+  static constexpr uint32_t Nil = UINT32_MAX;
+  static constexpr uint64_t Slots = UINT64_C(1) << LevelBits;
+  static constexpr uint64_t Mask = Slots - 1;
+  static constexpr uint64_t Span = UINT64_C(1) << (LevelBits * Levels);
+
+  struct Node {
+    Callback callback;
+    uint64_t expiry;
+    uint32_t prev;
+    uint32_t next;
+    uint32_t slot;
+    uint32_t generation;
+  };
+
+  TimerId add(uint64_t expiry, Callback callback) {
+    uint32_t index;
+    if (freeList != Nil) {
+      index = freeList;
+      freeList = nodes[index].next;
+    } else {
+      index = static_cast<uint32_t>(nodes.size());
+      nodes.push_back(Node{Callback(), 0, Nil, Nil, Nil, 0});
+    }
+
+    Node &node = nodes[index];
+    node.callback = std::move(callback);
+    node.expiry = (expiry > current) ? expiry : current + 1;
+    insert(index, current);
+    ++pending;
+    return TimerId{index, node.generation};
+  }
+
+  /*
+   * Puts the timer in the level matching its distance to reference
+   */
+  void insert(uint32_t index, uint64_t reference) {
+    Node &node = nodes[index];
+    uint64_t expiry = node.expiry;
+    if (expiry - reference >= Span) {
+      expiry = reference + Span - 1;
+    }
+    uint64_t delta = expiry - reference;
+
+    uint32_t level = 0;
+    while (level + 1 < Levels &&
+           delta >= (UINT64_C(1) << (LevelBits * (level + 1)))) {
+      ++level;
+    }
+    uint32_t slot = level * Slots + ((expiry >> (LevelBits * level)) & Mask);
+
+    node.slot = slot;
+    ++levelSizes[level];
+    node.prev = Nil;
+    node.next = heads[slot];
+    if (node.next != Nil) {
+      nodes[node.next].prev = index;
+    }
+    heads[slot] = index;
+  }
+
+  void unlink(uint32_t index) {
+    Node &node = nodes[index];
+    if (node.prev != Nil) {
+      nodes[node.prev].next = node.next;
+    } else {
+      heads[node.slot] = node.next;
+    }
+    if (node.next != Nil) {
+      nodes[node.next].prev = node.prev;
+    }
+    --levelSizes[node.slot / Slots];
+    node.slot = Nil;
+  }
+
+  void release(uint32_t index) {
+    Node &node = nodes[index];
+    node.callback = nullptr;
+    ++node.generation;
+    node.next = freeList;
+    freeList = index;
+    --pending;
+  }
+
+  /*
+   * Moves the timers of the upper levels whose slot starts at t down,
+   * highest level first, then fires the timers of t
+   */
+  void tick(uint64_t t, std::size_t &fired) {
+    int top = 0;
+    while (top + 1 < Levels &&
+           (t & ((UINT64_C(1) << (LevelBits * (top + 1))) - 1)) == 0) {
+      ++top;
+    }
+    for (int level = top; level >= 1; --level) {
+      uint32_t slot = level * Slots + ((t >> (LevelBits * level)) & Mask);
+      uint32_t index = heads[slot];
+      heads[slot] = Nil;
+      while (index != Nil) {
+        uint32_t next = nodes[index].next;
+        --levelSizes[level];
+        insert(index, t);
+        index = next;
+      }
+    }
+
+    current = t;
+    uint32_t slot = t & Mask;
+    while (heads[slot] != Nil) {
+      uint32_t index = heads[slot];
+      unlink(index);
+      if (nodes[index].expiry > t) {
+        insert(index, t); // clamped timer, still far away
+        continue;
+      }
+      Callback callback = std::move(nodes[index].callback);
+      release(index);
+      ++fired;
+      callback();
+    }
+  }
+
+  uint64_t current;
+  std::size_t pending;
+  std::vector<Node> nodes;
+  std::vector<uint32_t> heads;
+  std::vector<std::size_t> levelSizes;
+  uint32_t freeList;
+};
+
+} // namespace phy
+
+#endif // TIMER_WHEEL_H
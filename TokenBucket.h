@@ -0,0 +1,130 @@
+#ifndef TOKEN_BUCKET_H
+#define TOKEN_BUCKET_H
+
+#include <atomic>
+#include <cstdint>
+#include <ratio>
+#include <stdexcept>
+
+#include "TscClock.h"
+#include "Units.h"
+
+namespace phy {
+
+/*
+ * A lock-free token bucket, implemented as a generic cell rate algorithm:
+ * a single atomic "theoretical arrival time" moves forward by the refill
+ * time of each acquisition. The refill time of one token is a fixed-point
+ * number of nanoseconds with 32 fractional bits, on 128 bits so that slow
+ * rates fit, computed once: acquiring is a multiply-shift and a
+ * compare-exchange, without any division. The cost of an acquisition and
+ * the refill time of the capacity are both rounded up to the nanosecond,
+ * so that a full bucket grants its whole capacity at once; split in n
+ * acquisitions, the last one may wait up to n - 1 nanoseconds more.
+ *
+ * Q is the quantity of the tokens, for example Byte, or Qty<Radian> for a
+ * number of requests. Clock::now() gives the time as a Qty<Second, R>.
+ */
+template <class Q, class Clock = TscClock> class TokenBucket;
+
+template <class U, class R, class Clock> class TokenBucket<Qty<U, R>, Clock> {
+public:
+  using Quantity = Qty<U, R>;
+
+  template <typename RCapacity, typename RRate>
+  TokenBucket(Qty<U, RCapacity> capacity,
+              Qty<DivideReturnUnit<U, Second>, RRate> rate)
+      : tat(0) {
+    tokens = qtyFloorCast<Quantity>(capacity).value;
+    if (tokens <= 0 || rate.value <= 0) {
+      throw std::invalid_argument("TokenBucket: invalid capacity or rate");
+    }
+
+    /*
+     * 1e9 * R / (rate * RRate) nanoseconds per token
+     */
+    unsigned __int128 num = static_cast<unsigned __int128>(1000000000) *
+                            R::num * RRate::den;
+    unsigned __int128 den =
+        static_cast<unsigned __int128>(R::den) * RRate::num * rate.value;
+    interval = (num << 32) / den;
+    if (interval == 0) {
+      interval = 1;
+    }
+
+    /*
+     * The refill time of the whole capacity must fit in an intmax_t of
+     * nanoseconds (292 years)
+     */
+    if (interval >
+        (static_cast<unsigned __int128>(INTMAX_MAX) << 32) / tokens) {
+      throw std::invalid_argument("TokenBucket: capacity refilled too slowly");
+    }
+    tolerance = cost(tokens);
+  }
+
+  TokenBucket(const TokenBucket &) = delete;
+  TokenBucket &operator=(const TokenBucket &) = delete;
+
+  /*
+   * Takes amount tokens if they are available, the amount is rounded up
+   * to the ratio of the bucket
+   */
+  template <typename ROther> bool tryAcquire(Qty<U, ROther> q) {
+    intmax_t amount = qtyCeilCast<Quantity>(q).value;
+    if (amount <= 0) {
+      return true;
+    }
+    if (amount > tokens) {
+      return false;
+    }
+    const intmax_t refill = cost(amount);
+    intmax_t now = nanos();
+
+    intmax_t current = tat.load(std::memory_order_relaxed);
+    for (;;) {
+      intmax_t next = ((current > now) ? current : now) + refill;
+      if (next - now > tolerance) {
+        return false;
+      }
+      if (tat.compare_exchange_weak(current, next, std::memory_order_acq_rel,
+                                    std::memory_order_relaxed)) {
+        return true;
+      }
+    }
+  }
+
+  /*
+   * The tokens which could be acquired now
+   */
+  Quantity available() const {
+    intmax_t now = nanos();
+    intmax_t current = tat.load(std::memory_order_relaxed);
+    intmax_t debt = (current > now) ? current - now : 0;
+    intmax_t res = static_cast<intmax_t>(
+        (static_cast<unsigned __int128>(tolerance - debt) << 32) / interval);
+    return Quantity((res < tokens) ? res : tokens);
+  }
+
+private:
+  /*
+   * The refill time of amount tokens, in nanoseconds rounded up
+   */
+  intmax_t cost(intmax_t amount) const {
+    unsigned __int128 scaled = amount * interval;
+    return static_cast<intmax_t>((scaled + 0xFFFFFFFF) >> 32);
+  }
+
+  static intmax_t nanos() {
+    return qtyFloorCast<Qty<Second, std::nano>>(Clock::now()).value;
+  }
+
+  std::atomic<intmax_t> tat;
+  intmax_t tokens; // capacity
+  unsigned __int128 interval; // nanoseconds per token, 32 fractional bits
+  intmax_t tolerance;
+};
+
+} // namespace phy
+
+#endif // TOKEN_BUCKET_H
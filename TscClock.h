@@ -0,0 +1,136 @@
+#ifndef TSC_CLOCK_H
+#define TSC_CLOCK_H
+
+#include <cstdint>
+#include <ratio>
+#include <time.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#include <x86intrin.h>
+#define PHY_HAS_TSC 1
+#endif
+
+#include "Units.h"
+
+namespace phy {
+
+/*
+ * A clock reading the time stamp counter, on the same epoch as
+ * CLOCK_MONOTONIC (and SteadyClock). The ticks are turned into nanoseconds
+ * with a multiply-shift calibrated once, at the first use.
+ * Without an invariant TSC, it falls back to clock_gettime.
+ *
+ * The rate is measured over 20 ms against CLOCK_MONOTONIC. With about a
+ * microsecond of jitter on the reads, it is off by up to about 50 ppm, so
+ * the clock drifts from SteadyClock by up to 50 us per second elapsed
+ * since the calibration: it is meant for short intervals, SteadyClock
+ * for long ones.
+ */
+class TscClock {
+public:
+  using Duration = Qty<Second, std::nano>;
+
+  static Duration now() {
+    const Calibration &c = calibration();
+#ifdef PHY_HAS_TSC
+    if (c.tsc) {
+      return c.toNanos(__rdtsc());
+    }
+#endif
+    return monotonic();
+  }
+
+  /*
+   * Like now(), but waits for the previous instructions to complete
+   */
+  static Duration nowOrdered() {
+    const Calibration &c = calibration();
+#ifdef PHY_HAS_TSC
+    if (c.tsc) {
+      unsigned int aux;
+      return c.toNanos(__rdtscp(&aux));
+    }
+#endif
+    return monotonic();
+  }
+
+  /*
+   * Whether the time stamp counter is used
+   */
+  static bool usesTsc() { return calibration().tsc; }
+
+private:
+  struct Calibration {
+    bool tsc;
+    uint64_t baseTicks;
+    intmax_t baseNanos;
+    uint64_t mult; // nanoseconds per tick, 32 fractional bits
+
+    /*
+     * The delta is signed: on another core, the counter can read slightly
+     * before baseTicks right after the calibration
+     */
+    Duration toNanos(uint64_t ticks) const {
+      __int128 delta = static_cast<int64_t>(ticks - baseTicks);
+      return Duration(baseNanos +
+                      static_cast<intmax_t>((delta * mult) >> 32));
+    }
+  };
+
+  static Duration monotonic() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return Duration(static_cast<intmax_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec);
+  }
+
+  static bool invariantTsc() {
+#ifdef PHY_HAS_TSC
+    unsigned int eax, ebx, ecx, edx;
+    if (__get_cpuid(0x80000000, &eax, &ebx, &ecx, &edx) == 0 ||
+        eax < 0x80000007) {
+      return false;
+    }
+    __get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx);
+    return (edx >> 8) & 1;
+#else
+    return false;
+#endif
+  }
+
+  static Calibration calibrate() {
+    Calibration c{false, 0, 0, 0};
+#ifdef PHY_HAS_TSC
+    if (!invariantTsc()) {
+      return c;
+    }
+
+    intmax_t startNanos = monotonic().value;
+    uint64_t startTicks = __rdtsc();
+    timespec pause{0, 20000000};
+    nanosleep(&pause, nullptr);
+    uint64_t endTicks = __rdtsc();
+    intmax_t endNanos = monotonic().value;
+
+    if (endTicks <= startTicks || endNanos <= startNanos) {
+      return c;
+    }
+    c.tsc = true;
+    c.mult = static_cast<uint64_t>(
+        (static_cast<unsigned __int128>(endNanos - startNanos) << 32) /
+        (endTicks - startTicks));
+    c.baseTicks = endTicks;
+    c.baseNanos = endNanos;
+#endif
+    return c;
+  }
+
+  static const Calibration &calibration() {
+    static const Calibration c = calibrate();
+    return c;
+  }
+};
+
+} // namespace phy
+
+#endif // TSC_CLOCK_H
@@ -3,16 +3,19 @@
 
 #include <cstdint>
 #include <ratio>
+#include <type_traits>
 #include <stdio.h>
 
 //*
 namespace phy {
 
 /*
- * A unit defined in terms of the base units
+ * A unit defined in terms of the base units.
+ * The information dimension (bit) comes last and defaults to 0, so that
+ * Unit<1, 0, 0, 0, 0, 0, 0> and Unit<1, 0, 0, 0, 0, 0, 0, 0> are the same type
  */
 template <int Metre, int Kilogram, int Second, int Ampere, int Kelvin, int Mole,
-          int Candela>
+          int Candela, int Bit = 0>
 struct Unit {
   static constexpr int metre = Metre;
   static constexpr int kilogram = Kilogram;
@@ -21,6 +24,7 @@ struct Unit {
   static constexpr int kelvin = Kelvin;
   static constexpr int mole = Mole;
   static constexpr int candela = Candela;
+  static constexpr int bit = Bit;
 };
 
 /*
@@ -35,6 +39,25 @@ using Kelvin = Unit<0, 0, 0, 0, 1, 0, 0>;
 using Mole = Unit<0, 0, 0, 0, 0, 1, 0>;
 using Candela = Unit<0, 0, 0, 0, 0, 0, 1>;
 using Radian = Unit<0, 0, 0, 0, 0, 0, 0>;
+using Bit = Unit<0, 0, 0, 0, 0, 0, 0, 1>;
+
+/*
+ * Binary prefixes, the decimal ones are in <ratio>
+ */
+
+using Kibi = std::ratio<1024>;
+using Mebi = std::ratio<1024 * 1024>;
+using Gibi = std::ratio<1024 * 1024 * 1024>;
+using Tebi = std::ratio<1024LL * 1024 * 1024 * 1024>;
+
+/*
+ * Extension point for the implicit conversions between quantities and
+ * other types, e.g. the std::chrono durations of Chrono.h. A specialization
+ * for T defines:
+ *  - fromExact and from(T), to construct a Qty<U, R> from a T
+ *  - toExact and to(intmax_t), to convert a Qty<U, R> to a T
+ */
+template <class T, class U, class R> struct QtyConverter {};
 
 /*
  * A quantity is a value associated with a unit and a ratio
@@ -45,7 +68,17 @@ template <class U, class R = std::ratio<1>> struct Qty {
 
   intmax_t value;
 
-  Qty(intmax_t v) { this->value = v; };
+  constexpr Qty(intmax_t v) : value(v) {}
+
+  template <typename T, typename = typename std::enable_if<
+                            QtyConverter<T, U, R>::fromExact>::type>
+  constexpr Qty(T other) : value(QtyConverter<T, U, R>::from(other)) {}
+
+  template <typename T, typename = typename std::enable_if<
+                            QtyConverter<T, U, R>::toExact>::type>
+  constexpr operator T() const {
+    return QtyConverter<T, U, R>::to(value);
+  }
 
   template <typename ROther> Qty &operator+=(Qty<U, ROther> other) {
     this->value = (R::num * this->value * ROther::den) +
@@ -71,6 +104,7 @@ using Current = Qty<Ampere>;
 using Temperature = Qty<Kelvin>;
 using Amount = Qty<Mole>;
 using LuminousIntensity = Qty<Candela>;
+using Information = Qty<Bit>;
 
 /*
  * Some weird quantities
@@ -81,6 +115,18 @@ using Yard = Qty<Metre, std::ratio<10000, 10936>> /* implementation defined */;
 using Foot = Qty<Metre, std::ratio<10000, 32808>> /* implementation defined */;
 using Inch = Qty<Metre, std::ratio<10000, 393700>> /* implementation defined */;
 
+/*
+ * Bytes, with decimal and binary prefixes
+ */
+
+using Byte = Qty<Bit, std::ratio<8>>;
+using Kilobyte = Qty<Bit, std::ratio_multiply<std::ratio<8>, std::kilo>>;
+using Megabyte = Qty<Bit, std::ratio_multiply<std::ratio<8>, std::mega>>;
+using Gigabyte = Qty<Bit, std::ratio_multiply<std::ratio<8>, std::giga>>;
+using Kibibyte = Qty<Bit, std::ratio_multiply<std::ratio<8>, Kibi>>;
+using Mebibyte = Qty<Bit, std::ratio_multiply<std::ratio<8>, Mebi>>;
+using Gibibyte = Qty<Bit, std::ratio_multiply<std::ratio<8>, Gibi>>;
+
 /*
  * Cast function between two quantities
  */
@@ -91,6 +137,48 @@ ResQty qtyCast(Qty<U, R> &other) {
       (R::den * ResQty::Ratio::num));
 }
 
+namespace internal {
+
+inline intmax_t saturatedValue(__int128 value) {
+  if (value > INTMAX_MAX) {
+    return INTMAX_MAX;
+  }
+  if (value < INTMAX_MIN) {
+    return INTMAX_MIN;
+  }
+  return static_cast<intmax_t>(value);
+}
+
+} // namespace internal
+
+/*
+ * Rounding cast functions: the exact floor (resp. ceil) of the value
+ * expressed in the ratio of ResQty, used to turn thresholds into bounds.
+ * The product is computed on 128 bits, a result out of the range of the
+ * representation saturates, so that such a bound is beyond every value.
+ */
+template <typename ResQty, typename U, typename R>
+ResQty qtyFloorCast(Qty<U, R> other) {
+  using Factor = std::ratio_divide<R, typename ResQty::Ratio>;
+  __int128 scaled = static_cast<__int128>(other.value) * Factor::num;
+  __int128 res = scaled / Factor::den;
+  if (scaled % Factor::den != 0 && scaled < 0) {
+    --res;
+  }
+  return Qty<U, typename ResQty::Ratio>(internal::saturatedValue(res));
+}
+
+template <typename ResQty, typename U, typename R>
+ResQty qtyCeilCast(Qty<U, R> other) {
+  using Factor = std::ratio_divide<R, typename ResQty::Ratio>;
+  __int128 scaled = static_cast<__int128>(other.value) * Factor::num;
+  __int128 res = scaled / Factor::den;
+  if (scaled % Factor::den != 0 && scaled > 0) {
+    ++res;
+  }
+  return Qty<U, typename ResQty::Ratio>(internal::saturatedValue(res));
+}
+
 /*
  * Comparison operators
  */
@@ -187,7 +275,7 @@ template <typename U1, typename U2>
 using MultiReturnUnit = Unit<U1::metre + U2::metre, U1::kilogram + U2::kilogram,
                              U1::second + U2::second, U1::ampere + U2::ampere,
                              U1::kelvin + U2::kelvin, U1::mole + U2::mole,
-                             U1::candela + U2::candela>;
+                             U1::candela + U2::candela, U1::bit + U2::bit>;
 
 /*
  * If U1 == U2 we convert the unit in the smaller ratio and apply the multiplication
@@ -222,7 +310,7 @@ template <typename U1,typename U2>
 using DivideReturnUnit = Unit<U1::metre - U2::metre, U1::kilogram - U2::kilogram,
                              U1::second - U2::second, U1::ampere - U2::ampere,
                              U1::kelvin - U2::kelvin, U1::mole - U2::mole,
-                             U1::candela - U2::candela>;
+                             U1::candela - U2::candela, U1::bit - U2::bit>;
 
 /*
   * If DivideReturnUnit is composed with only 0, the division is without unit.
@@ -237,13 +325,15 @@ Qty<DivideReturnUnit<U1,U2>, typename std::conditional<
       (DivideReturnUnit<U1, U2>::metre == 0 && DivideReturnUnit<U1, U2>::kilogram == 0 &&
         DivideReturnUnit<U1, U2>::second == 0 && DivideReturnUnit<U1, U2>::ampere == 0 &&
         DivideReturnUnit<U1, U2>::kelvin == 0 && DivideReturnUnit<U1, U2>::mole == 0 &&
-        DivideReturnUnit<U1, U2>::candela == 0), std::ratio<1>, std::ratio_divide<R1, R2>>::type>
+        DivideReturnUnit<U1, U2>::candela == 0 && DivideReturnUnit<U1, U2>::bit == 0),
+      std::ratio<1>, std::ratio_divide<R1, R2>>::type>
 operator/(Qty<U1, R1> q1, Qty<U2, R2> q2) {
 
   const bool condition = (DivideReturnUnit<U1, U2>::metre == 0 && DivideReturnUnit<U1, U2>::kilogram == 0 &&
                               DivideReturnUnit<U1, U2>::second == 0 && DivideReturnUnit<U1, U2>::ampere == 0 &&
                               DivideReturnUnit<U1, U2>::kelvin == 0 && DivideReturnUnit<U1, U2>::mole == 0 &&
-                              DivideReturnUnit<U1, U2>::candela == 0);
+                              DivideReturnUnit<U1, U2>::candela == 0 &&
+                              DivideReturnUnit<U1, U2>::bit == 0);
 
   typedef
     typename std::conditional<condition, std::ratio<1>, std::ratio_divide<R1, R2>>::type newRatio;
@@ -287,6 +377,12 @@ namespace literals {
   LuminousIntensity operator"" _candelas(unsigned long long int val) {
     return Qty<Candela, std::ratio<1, 1>>(val);
   }
+  inline Information operator"" _bits(unsigned long long int val) {
+    return Qty<Bit, std::ratio<1, 1>>(val);
+  }
+  inline Byte operator"" _bytes(unsigned long long int val) {
+    return Qty<Bit, std::ratio<8, 1>>(val);
+  }
 
 } // namespace literals
 
@@ -314,6 +410,7 @@ namespace details {
   using Speed = Unit<1, 0, -1, 0, 0, 0, 0>; //m.s-1
   using Voltage = Unit<2, 1, -3, -1, 0, 0, 0>; //Volt
   using Volume = Unit<3, 0, 0, 0, 0, 0, 0>; //m3
+  using DataRate = Unit<0, 0, -1, 0, 0, 0, 0, 1>; //bit.s-1
 
 
 } // namespace details
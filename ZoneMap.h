@@ -0,0 +1,129 @@
+#ifndef ZONE_MAP_H
+#define ZONE_MAP_H
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "Codec.h"
+#include "Filter.h"
+#include "Units.h"
+
+namespace phy {
+
+/*
+ * The position and the value range of a compressed block
+ */
+struct BlockZone {
+  std::size_t offset; // of the block header in the compressed data
+  std::size_t row;    // of the first value of the block
+  std::size_t count;
+  intmax_t min;
+  intmax_t max;
+};
+
+/*
+ * A compressed column of quantities Q, read through the zone maps of its
+ * blocks: range predicates only decompress the blocks which straddle one
+ * of the bounds, the others being skipped or selected as a whole.
+ * The column owns its compressed data, whose block headers are validated
+ * once: a malformed column throws std::runtime_error.
+ */
+template <class Q> class CompressedColumn {
+public:
+  explicit CompressedColumn(std::vector<uint8_t> compressed)
+      : data(std::move(compressed)), rows(0) {
+    const ColumnSchema schema = ColumnSchema::of<Q>();
+    std::size_t offset = 0;
+    while (offset < data.size()) {
+      CodecBlockHeader header =
+          internal::blockHeader(data.data() + offset, data.size() - offset);
+      if (header.schema != schema) {
+        throw std::runtime_error(
+            "CompressedColumn: block does not hold the quantity");
+      }
+      if (rows % CodecBlockHeader::BlockSize != 0) {
+        throw std::runtime_error("CompressedColumn: partial inner block");
+      }
+      zones.push_back(
+          BlockZone{offset, rows, header.count, header.min, header.max});
+      rows += header.count;
+      offset += sizeof(header) + header.size;
+    }
+  }
+
+  std::size_t size() const { return rows; }
+  const std::vector<BlockZone> &blocks() const { return zones; }
+
+  std::vector<Q> decode() const {
+    intmax_t block[CodecBlockHeader::BlockSize];
+    std::vector<Q> res;
+    res.reserve(rows);
+    for (const BlockZone &zone : zones) {
+      internal::decodeBlock(data.data() + zone.offset,
+                            data.size() - zone.offset, block);
+      for (std::size_t i = 0; i < zone.count; ++i) {
+        res.push_back(Q(block[i]));
+      }
+    }
+    return res;
+  }
+
+  /*
+   * Selects the values in [lo, hi), the bounds being converted once into
+   * the ratio of the column
+   */
+  template <typename U, typename RLo, typename RHi>
+  Bitmap selectBetween(Qty<U, RLo> lo, Qty<U, RHi> hi) const {
+    static_assert(std::is_same<typename Q::Unit, U>::value,
+                  "the bounds must have the unit of the column");
+
+    Bitmap res(rows);
+    intmax_t min = qtyCeilCast<Q>(lo).value;
+    intmax_t bound = qtyCeilCast<Q>(hi).value;
+    if (bound == std::numeric_limits<intmax_t>::min() || min > bound - 1) {
+      return res;
+    }
+    intmax_t max = bound - 1;
+
+    intmax_t block[CodecBlockHeader::BlockSize];
+    for (const BlockZone &zone : zones) {
+      if (zone.max < min || zone.min > max) {
+        continue;
+      }
+      if (zone.min >= min && zone.max <= max) {
+        for (std::size_t i = 0; i < zone.count; ++i) {
+          std::size_t row = zone.row + i;
+          res.data()[row / 64] |= UINT64_C(1) << (row % 64);
+        }
+        continue;
+      }
+      internal::decodeBlock(data.data() + zone.offset,
+                            data.size() - zone.offset, block);
+      internal::scanRange(block, zone.count, min, max,
+                          res.data() + zone.row / 64);
+    }
+    return res;
+  }
+
+  /*
+   * Indices of the values in [lo, hi)
+   */
+  template <typename U, typename RLo, typename RHi>
+  std::vector<std::size_t> where(Qty<U, RLo> lo, Qty<U, RHi> hi) const {
+    return selectBetween(lo, hi).indices();
+  }
+
+private:
+  std::vector<uint8_t> data;
+  std::vector<BlockZone> zones;
+  std::size_t rows;
+};
+
+} // namespace phy
+
+#endif // ZONE_MAP_H
@@ -1,6 +1,36 @@
 #include "Units.h"
 
+#include "Arrow.h"
+#include "AtomicQty.h"
+#include "Calculus.h"
+#include "Chrono.h"
+#include "Codec.h"
+#include "ColumnFile.h"
+#include "Csv.h"
+#include "Filter.h"
+#include "HdrHistogram.h"
+#include "Histogram.h"
+#include "Json.h"
+#include "Metrics.h"
+#include "Parallel.h"
+#include "Pipeline.h"
+#include "RuntimeUnit.h"
+#include "Scan.h"
+#include "ShardedQty.h"
+#include "SharedRing.h"
+#include "SpscQueue.h"
+#include "Statistics.h"
+#include "TimeSeries.h"
+#include "TimerWheel.h"
+#include "TokenBucket.h"
+#include "TscClock.h"
+#include "ZoneMap.h"
+
+#include <filesystem>
+#include <fstream>
 #include <iostream>
+#include <sstream>
+#include <thread>
 
 #include <gtest/gtest.h>
 using namespace phy;
@@ -348,3 +378,1536 @@ TEST(ValidUnit, Velocity){
   EXPECT_EQ(typeid(h), typeSecond);
   EXPECT_EQ(typeid(velocity), typeVelocity);
 }
+
+
+TEST(Cast, FloorCeil) {
+  phy::Qty<phy::Metre, std::milli> mm(2500);
+  EXPECT_EQ(phy::qtyFloorCast<phy::Length>(mm).value, 2);
+  EXPECT_EQ(phy::qtyCeilCast<phy::Length>(mm).value, 3);
+
+  phy::Qty<phy::Metre, std::milli> neg(-2500);
+  EXPECT_EQ(phy::qtyFloorCast<phy::Length>(neg).value, -3);
+  EXPECT_EQ(phy::qtyCeilCast<phy::Length>(neg).value, -2);
+
+  using Millimetre = phy::Qty<phy::Metre, std::milli>;
+  phy::Qty<phy::Metre, std::kilo> above(10000000000000000);
+  phy::Qty<phy::Metre, std::kilo> below(-10000000000000000);
+  EXPECT_EQ(phy::qtyFloorCast<Millimetre>(above).value, INTMAX_MAX);
+  EXPECT_EQ(phy::qtyCeilCast<Millimetre>(below).value, INTMAX_MIN);
+
+  std::vector<Millimetre> column = {Millimetre(-5), Millimetre(5),
+                                    Millimetre(INTMAX_MAX - 1)};
+  EXPECT_EQ(phy::selectGreater(phy::QtySpan(column), above).count(), 0u);
+  EXPECT_EQ(phy::selectLess(phy::QtySpan(column), above).count(), 3u);
+  EXPECT_EQ(phy::selectGreater(phy::QtySpan(column), below).count(), 3u);
+  EXPECT_EQ(phy::selectLessEqual(phy::QtySpan(column), below).count(), 0u);
+}
+
+TEST(Filter, SpeedGreater) {
+  using namespace phy::details;
+
+  std::vector<phy::Qty<Speed>> speeds;
+  for (int i = 0; i < 200; ++i) {
+    speeds.push_back(phy::Qty<Speed>(i % 20)); // m.s-1
+  }
+  phy::Qty<Speed, std::ratio<1000, 3600>> limit(30); // 30 km/h = 8.33 m/s
+
+  auto selected = phy::selectGreater(phy::QtySpan(speeds), limit);
+  EXPECT_EQ(selected.size(), 200u);
+  EXPECT_EQ(selected.count(), 110u);
+  EXPECT_FALSE(selected.test(8));
+  EXPECT_TRUE(selected.test(9));
+  EXPECT_TRUE(selected.test(199));
+
+  auto below = phy::selectLessEqual(phy::QtySpan(speeds), limit);
+  EXPECT_EQ(below.count(), 90u);
+}
+
+TEST(Filter, WhereMixedRatios) {
+  std::vector<phy::Qty<phy::Metre, std::milli>> column;
+  for (int i = 0; i < 130; ++i) {
+    column.push_back(phy::Qty<phy::Metre, std::milli>(i * 10));
+  }
+  phy::Qty<phy::Metre, std::centi> lo(5);   // 50 mm
+  phy::Qty<phy::Metre, std::milli> hi(1205); // 1205 mm
+
+  auto indices = phy::where(phy::QtySpan(column), lo, hi);
+  ASSERT_EQ(indices.size(), 116u);
+  EXPECT_EQ(indices.front(), 5u);
+  EXPECT_EQ(indices.back(), 120u);
+
+  auto greaterEqual = phy::selectGreaterEqual(phy::QtySpan(column), lo);
+  auto less = phy::selectLess(phy::QtySpan(column), lo);
+  EXPECT_EQ(greaterEqual.count() + less.count(), column.size());
+}
+
+TEST(Histogram, UniformMilli) {
+  using Millimetre = phy::Qty<phy::Metre, std::milli>;
+  auto histogram = phy::Histogram<Millimetre>::uniform(
+      phy::Qty<phy::Metre>(0), phy::Qty<phy::Metre, std::centi>(50), 5); // 100 mm bins
+
+  std::vector<Millimetre> samples;
+  for (int i = -10; i < 600; ++i) {
+    samples.push_back(Millimetre(i));
+  }
+  histogram.insert(phy::QtySpan(samples));
+  histogram.insert(phy::Qty<phy::Metre, std::centi>(25)); // 250 mm
+
+  EXPECT_EQ(histogram.bins(), 5u);
+  EXPECT_EQ(histogram.underflow(), 10u);
+  EXPECT_EQ(histogram.count(0), 100u);
+  EXPECT_EQ(histogram.count(2), 101u);
+  EXPECT_EQ(histogram.count(4), 100u);
+  EXPECT_EQ(histogram.overflow(), 100u);
+  EXPECT_EQ(histogram.total(), 611u);
+  EXPECT_EQ(histogram.upperEdge(0).value, 100);
+}
+
+TEST(Histogram, EdgesAndMerge) {
+  using Millimetre = phy::Qty<phy::Metre, std::milli>;
+  std::vector<phy::Qty<phy::Metre, std::centi>> edges{
+      phy::Qty<phy::Metre, std::centi>(1), phy::Qty<phy::Metre, std::centi>(2),
+      phy::Qty<phy::Metre, std::centi>(5), phy::Qty<phy::Metre, std::centi>(20)};
+  phy::Histogram<Millimetre> first(edges);
+  phy::Histogram<Millimetre> second(edges);
+
+  first.insert(Millimetre(9));
+  first.insert(Millimetre(10));
+  first.insert(Millimetre(49));
+  second.insert(Millimetre(50));
+  second.insert(Millimetre(199));
+  second.insert(Millimetre(200));
+  first.merge(second);
+
+  EXPECT_EQ(first.underflow(), 1u);
+  EXPECT_EQ(first.count(0), 1u);
+  EXPECT_EQ(first.count(1), 1u);
+  EXPECT_EQ(first.count(2), 2u);
+  EXPECT_EQ(first.overflow(), 1u);
+
+  auto other = phy::Histogram<Millimetre>::uniform(Millimetre(0), Millimetre(10), 2);
+  EXPECT_THROW(first.merge(other), std::invalid_argument);
+}
+
+TEST(Histogram, Logarithmic) {
+  auto histogram = phy::Histogram<phy::Time>::logarithmic(
+      phy::Qty<phy::Second>(1), phy::Qty<phy::Second>(1000), 3);
+
+  EXPECT_EQ(histogram.lowerEdge(1).value, 10);
+  EXPECT_EQ(histogram.lowerEdge(2).value, 100);
+
+  histogram.insert(phy::Qty<phy::Second>(5));
+  histogram.insert(phy::Qty<phy::Second>(500));
+  histogram.insert(phy::Qty<phy::Second, std::milli>(99999));
+  EXPECT_EQ(histogram.count(0), 1u);
+  EXPECT_EQ(histogram.count(1), 1u);
+  EXPECT_EQ(histogram.count(2), 1u);
+}
+
+TEST(Histogram, LogarithmicNarrowRange) {
+  using Histogram = phy::Histogram<phy::Time>;
+  EXPECT_THROW(Histogram::logarithmic(phy::Time(1), phy::Time(10), 20),
+               std::invalid_argument);
+
+  auto full = Histogram::logarithmic(phy::Time(1), phy::Time(10), 9);
+  for (std::size_t bin = 0; bin < full.bins(); ++bin) {
+    EXPECT_EQ(full.lowerEdge(bin).value, intmax_t(bin + 1));
+  }
+
+  auto dense = Histogram::logarithmic(phy::Time(1), phy::Time(100), 20);
+  for (std::size_t bin = 0; bin < dense.bins(); ++bin) {
+    EXPECT_LT(dense.lowerEdge(bin).value, dense.upperEdge(bin).value);
+  }
+  EXPECT_EQ(dense.upperEdge(19).value, 100);
+}
+
+TEST(HdrHistogram, Percentiles) {
+  phy::LatencyHistogram<> latencies; // ns
+  for (int i = 1; i <= 1000; ++i) {
+    latencies.record(phy::Qty<phy::Second, std::micro>(i));
+  }
+  auto snapshot = latencies.snapshot();
+  EXPECT_EQ(snapshot.total(), 1000u);
+
+  auto median = snapshot.percentile(50);
+  EXPECT_EQ(typeid(median), typeid(phy::Qty<phy::Second, std::nano>(0)));
+  EXPECT_GE(median.value, 500000);
+  EXPECT_LE(median.value, 500000 + 500000 / 64);
+
+  auto max = snapshot.max();
+  EXPECT_GE(max.value, 1000000);
+  EXPECT_LE(max.value, 1000000 + 1000000 / 64);
+
+  latencies.record(phy::Qty<phy::Second, std::nano>(42));
+  EXPECT_EQ(latencies.snapshot().percentile(0).value, 42);
+}
+
+TEST(HdrHistogram, ConcurrentRecordAndMerge) {
+  phy::LatencyHistogram<std::micro> first;
+  phy::LatencyHistogram<std::micro> second;
+
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; ++t) {
+    threads.emplace_back([&first] {
+      for (int i = 0; i < 10000; ++i) {
+        first.record(phy::Qty<phy::Second, std::milli>(i % 10));
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  second.record(phy::Qty<phy::Second>(2), 10);
+
+  auto snapshot = first.snapshot();
+  snapshot.merge(second.snapshot());
+  EXPECT_EQ(snapshot.total(), 40010u);
+  EXPECT_GE(snapshot.max().value, 2000000);
+  EXPECT_LE(snapshot.percentile(10).value, 1000 + 1000 / 64);
+}
+
+TEST(Statistics, MeanVariance) {
+  phy::Statistics<phy::Length> stats;
+  for (int v : {2, 4, 4, 4, 5, 5, 7, 9}) {
+    stats.add(phy::Length(v));
+  }
+
+  EXPECT_EQ(stats.count(), 8u);
+  EXPECT_EQ(stats.mean().value, 5);
+  EXPECT_EQ(stats.variance().value, 4);
+  EXPECT_EQ(stats.min().value, 2);
+  EXPECT_EQ(stats.max().value, 9);
+
+  phy::Qty<phy::details::Superficie> squareMetres(0);
+  EXPECT_EQ(typeid(stats.variance()), typeid(squareMetres));
+}
+
+TEST(Statistics, BatchAndMerge) {
+  using Millimetre = phy::Qty<phy::Metre, std::milli>;
+  std::vector<Millimetre> first;
+  std::vector<Millimetre> second;
+  phy::Statistics<Millimetre> sequential;
+  for (int i = 0; i < 1001; ++i) {
+    Millimetre value((i * 37) % 101);
+    (i < 600 ? first : second).push_back(value);
+    sequential.add(value);
+  }
+
+  phy::Statistics<Millimetre> left;
+  phy::Statistics<Millimetre> right;
+  left.add(phy::QtySpan(first));
+  right.add(phy::QtySpan(second));
+  left.merge(right);
+
+  EXPECT_EQ(left.count(), sequential.count());
+  EXPECT_EQ(left.mean().value, sequential.mean().value);
+  EXPECT_EQ(left.variance().value, sequential.variance().value);
+  EXPECT_EQ(left.min().value, 0);
+  EXPECT_EQ(left.max().value, 100);
+}
+
+TEST(Statistics, RatioAndLargeValues) {
+  using Millimetre = phy::Qty<phy::Metre, std::milli>;
+  phy::Statistics<Millimetre> lengths;
+  lengths.add(Millimetre(0));
+  lengths.add(Millimetre(2000));
+  using SquareMicrometre =
+      phy::Qty<phy::details::Superficie, std::ratio<1, 1000000>>;
+  EXPECT_EQ(typeid(lengths.variance()), typeid(SquareMicrometre(0)));
+  auto variance = lengths.variance();
+  EXPECT_EQ(phy::qtyCast<phy::Qty<phy::details::Superficie>>(variance).value,
+            1);
+
+  using Nanosecond = phy::Qty<phy::Second, std::nano>;
+  std::vector<Nanosecond> timestamps;
+  for (intmax_t i = 0; i < 8; ++i) {
+    timestamps.push_back(Nanosecond(1700000000000000000 + i * 1000));
+  }
+  phy::Statistics<Nanosecond> stats;
+  stats.add(phy::QtySpan(timestamps));
+  EXPECT_EQ(stats.mean().value, 1700000000000003500);
+  EXPECT_EQ(stats.variance().value, 5250000);
+
+  phy::Statistics<Nanosecond> close;
+  for (intmax_t i = 0; i < 3; ++i) {
+    close.add(Nanosecond(1700000000000000000 + i));
+  }
+  EXPECT_EQ(close.mean().value, 1700000000000000001);
+  EXPECT_EQ(close.variance().value, 1);
+
+  phy::Statistics<Nanosecond> merged;
+  merged.merge(close);
+  merged.merge(stats);
+  EXPECT_EQ(merged.count(), 11u);
+  EXPECT_EQ(merged.mean().value, 1700000000000002546);
+  EXPECT_EQ(merged.variance().value, 6246546);
+
+  phy::Statistics<Nanosecond> spread;
+  spread.add(Nanosecond(0));
+  spread.add(Nanosecond(10000000000));
+  EXPECT_THROW(spread.variance(), std::overflow_error);
+  EXPECT_EQ(spread.mean().value, 5000000000);
+}
+
+TEST(AtomicQty, FetchAddMixedRatios) {
+  using Joule = phy::details::Energy;
+  phy::AtomicQty<Joule, std::milli> energy;
+  EXPECT_TRUE(energy.is_lock_free());
+
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; ++t) {
+    threads.emplace_back([&energy] {
+      for (int i = 0; i < 1000; ++i) {
+        energy.fetch_add(phy::Qty<Joule>(1), std::memory_order_relaxed);
+        energy.fetch_add(phy::Qty<Joule, std::milli>(5), std::memory_order_relaxed);
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+
+  EXPECT_EQ(energy.load(std::memory_order_acquire).value, 4 * 1000 * 1005);
+  auto previous = energy.fetch_sub(phy::Qty<Joule, std::kilo>(1), std::memory_order_acq_rel);
+  EXPECT_EQ(previous.value, 4020000);
+  EXPECT_EQ(energy.load(std::memory_order_relaxed).value, 3020000);
+}
+
+TEST(AtomicQty, CompareExchange) {
+  phy::AtomicQty<phy::Kilogram, std::milli> mass(phy::Qty<phy::Kilogram, std::milli>(10));
+
+  phy::Qty<phy::Kilogram, std::milli> expected(3);
+  EXPECT_FALSE(mass.compare_exchange_strong(expected, phy::Qty<phy::Kilogram>(1),
+                                            std::memory_order_acq_rel,
+                                            std::memory_order_acquire));
+  EXPECT_EQ(expected.value, 10);
+  EXPECT_TRUE(mass.compare_exchange_strong(expected, phy::Qty<phy::Kilogram>(1),
+                                           std::memory_order_acq_rel,
+                                           std::memory_order_acquire));
+  EXPECT_EQ(mass.load(std::memory_order_relaxed).value, 1000);
+
+  mass.store(phy::Qty<phy::Kilogram, std::milli>(7), std::memory_order_release);
+  EXPECT_EQ(mass.exchange(phy::Qty<phy::Kilogram>(2), std::memory_order_acq_rel).value, 7);
+}
+
+TEST(ShardedQty, MergeOnRead) {
+  phy::ShardedQty<phy::Metre, std::milli> distance(3);
+  EXPECT_EQ(distance.shards(), 3u);
+
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 8; ++t) {
+    threads.emplace_back([&distance] {
+      for (int i = 0; i < 1000; ++i) {
+        distance.add(phy::Qty<phy::Metre>(1));
+        distance.sub(phy::Qty<phy::Metre, std::milli>(1));
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+
+  EXPECT_EQ(distance.read().value, 8 * 1000 * 999);
+  EXPECT_EQ(distance.reset().value, 8 * 1000 * 999);
+  EXPECT_EQ(distance.read().value, 0);
+}
+
+TEST(Metrics, BaseUnitNames) {
+  using namespace phy::details;
+
+  EXPECT_EQ(phy::baseUnitName<phy::Second>(), "seconds");
+  EXPECT_EQ(phy::baseUnitName<Speed>(), "metres_per_second");
+  EXPECT_EQ(phy::baseUnitName<Power>(), "metres2_kilograms_per_second3");
+  EXPECT_EQ(phy::baseUnitName<Frequency>(), "per_second");
+  EXPECT_EQ(phy::baseUnitName<phy::Radian>(), "");
+}
+
+TEST(Metrics, Exposition) {
+  using Microseconds = phy::Qty<phy::Second, std::micro>;
+  phy::MetricsRegistry registry;
+
+  auto &busy = registry.counter<Microseconds>("busy", "Busy time");
+  auto &power = registry.gauge<phy::Qty<phy::details::Power, std::kilo>>("power", "Power draw");
+  auto &latency = registry.distribution<phy::Qty<phy::Second, std::nano>>(
+      "request_latency_seconds", "Request latency");
+
+  busy.add(phy::Qty<phy::Second, std::milli>(3));
+  busy.add(phy::Qty<phy::Second, std::micro>(500));
+  power.set(phy::Qty<phy::details::Power, std::kilo>(2));
+  latency.record(phy::Qty<phy::Second, std::milli>(1));
+  latency.record(phy::Qty<phy::Second, std::micro>(500));
+  EXPECT_THROW(busy.add(phy::Qty<phy::Second>(-1)), std::invalid_argument);
+
+  EXPECT_EQ(&registry.counter<Microseconds>("busy", "Busy time"), &busy);
+  EXPECT_THROW(registry.gauge<phy::Qty<phy::Second>>("request_latency", ""),
+               std::invalid_argument);
+
+  std::ostringstream out;
+  registry.expose(out);
+  std::string text = out.str();
+
+  EXPECT_NE(text.find("# TYPE busy_seconds_total counter\nbusy_seconds_total 0.0035\n"),
+            std::string::npos);
+  EXPECT_NE(text.find("power_metres2_kilograms_per_second3 2000\n"), std::string::npos);
+  EXPECT_NE(text.find("# TYPE request_latency_seconds summary\n"), std::string::npos);
+  EXPECT_NE(text.find("request_latency_seconds_sum 0.0015\n"),
+            std::string::npos);
+  EXPECT_NE(text.find("request_latency_seconds_count 2\n"), std::string::npos);
+
+  registry.gauge<phy::Qty<phy::Second>>("uptime", "Time since start\nin C:\\");
+  out.str("");
+  registry.expose(out);
+  EXPECT_NE(out.str().find("# HELP uptime_seconds Time since start\\nin C:\\\\\n"),
+            std::string::npos);
+}
+
+TEST(Chrono, DurationConversions) {
+  constexpr phy::Qty<phy::Second, std::milli> ms = std::chrono::seconds(2);
+  static_assert(ms.value == 2000, "exact conversion from a duration");
+
+  constexpr std::chrono::microseconds us = ms;
+  static_assert(us.count() == 2000000, "exact conversion to a duration");
+
+  std::chrono::duration<double> seconds = ms;
+  EXPECT_DOUBLE_EQ(seconds.count(), 2.0);
+
+  static_assert(!std::is_convertible<std::chrono::microseconds,
+                                     phy::Qty<phy::Second, std::milli>>::value,
+                "lossy conversions are not implicit");
+  static_assert(!std::is_convertible<phy::Qty<phy::Second, std::milli>,
+                                     std::chrono::seconds>::value,
+                "lossy conversions are not implicit");
+  static_assert(!std::is_convertible<std::chrono::seconds, phy::Length>::value,
+                "only times convert to durations");
+}
+
+TEST(Chrono, SteadyTimePoint) {
+  auto start = phy::SteadyTimePoint<>::now();
+  auto later = start + phy::Qty<phy::Second, std::milli>(5);
+
+  phy::Qty<phy::Second, std::nano> elapsed = later - start;
+  EXPECT_EQ(elapsed.value, 5000000);
+  EXPECT_TRUE(start < later);
+
+  std::chrono::steady_clock::time_point chrono = later;
+  EXPECT_TRUE(phy::SteadyTimePoint<>(chrono) == later);
+
+  auto now = phy::SteadyClock::now();
+  EXPECT_GE(now.value, start.timeSinceEpoch().value);
+}
+
+TEST(TscClock, FollowsTheSteadyClock) {
+  auto first = phy::TscClock::now();
+  auto steady = phy::SteadyClock::now();
+  auto second = phy::TscClock::nowOrdered();
+
+  EXPECT_EQ(typeid(first), typeid(phy::Qty<phy::Second, std::nano>(0)));
+  EXPECT_LE(first.value, second.value);
+  EXPECT_LT(std::abs(steady.value - first.value), 1000000); // 1 ms
+}
+
+TEST(Information, BytesAndRates) {
+  using namespace phy::literals;
+  using namespace phy::details;
+
+  phy::Byte sent = 3000_bytes;
+  phy::Qty<phy::Second, std::milli> duration(1500);
+  auto rate = sent / duration; // 2 B.ms-1
+
+  EXPECT_EQ(rate.value, 2);
+  EXPECT_EQ(typeid(rate), typeid(phy::Qty<DataRate, std::ratio<8000>>(0)));
+
+  phy::Kibibyte kib(3);
+  auto bits = phy::qtyCast<phy::Information>(kib);
+  EXPECT_EQ(bits.value, 3 * 1024 * 8);
+  EXPECT_EQ((phy::Kilobyte(3) + 24_bits).value, 24024);
+  EXPECT_EQ(phy::Megabyte(1), phy::Byte(1000000));
+  EXPECT_NE(phy::Mebibyte(1), phy::Byte(1000000));
+
+  auto ratio = sent / phy::Byte(1000);
+  EXPECT_EQ(typeid(ratio), typeid(phy::Qty<phy::Radian>(0)));
+  EXPECT_EQ(phy::baseUnitName<DataRate>(), "bits_per_second");
+}
+
+TEST(Information, SevenDimensionUnitsUnchanged) {
+  EXPECT_EQ(typeid(phy::Unit<1, 0, -1, 0, 0, 0, 0>),
+            typeid(phy::Unit<1, 0, -1, 0, 0, 0, 0, 0>));
+  EXPECT_EQ(phy::Metre::bit, 0);
+}
+
+struct ManualClock {
+  static inline intmax_t nanos = 1000000000;
+  static phy::Qty<phy::Second, std::nano> now() { return nanos; }
+};
+
+TEST(TokenBucket, BytesPerSecond) {
+  using MegabytePerSecond = phy::Qty<phy::details::DataRate, std::ratio<8000000>>;
+  phy::TokenBucket<phy::Byte, ManualClock> bucket(phy::Kibibyte(1), MegabytePerSecond(1));
+
+  EXPECT_TRUE(bucket.tryAcquire(phy::Kibibyte(1)));
+  EXPECT_FALSE(bucket.tryAcquire(phy::Byte(1)));
+
+  ManualClock::nanos += 1000; // 1 byte refilled
+  EXPECT_TRUE(bucket.tryAcquire(phy::Qty<phy::Bit>(5))); // rounded up to 1 byte
+  EXPECT_FALSE(bucket.tryAcquire(phy::Byte(1)));
+
+  ManualClock::nanos += 512000;
+  EXPECT_EQ(bucket.available().value, 512);
+  EXPECT_TRUE(bucket.tryAcquire(phy::Byte(512)));
+  EXPECT_FALSE(bucket.tryAcquire(phy::Byte(1)));
+
+  ManualClock::nanos += 1000000000;
+  EXPECT_FALSE(bucket.tryAcquire(phy::Kibibyte(2)));
+  EXPECT_TRUE(bucket.tryAcquire(phy::Kilobyte(1)));
+}
+
+TEST(TokenBucket, RequestsPerMillisecond) {
+  using Requests = phy::Qty<phy::Radian>;
+  using PerMillisecond = phy::Qty<phy::details::Frequency, std::kilo>;
+  phy::TokenBucket<Requests, ManualClock> bucket(Requests(3), PerMillisecond(2));
+
+  int accepted = 0;
+  for (int i = 0; i < 10; ++i) {
+    accepted += bucket.tryAcquire(Requests(1));
+  }
+  EXPECT_EQ(accepted, 3);
+
+  ManualClock::nanos += 1000000; // 1 ms, 2 requests
+  accepted = 0;
+  for (int i = 0; i < 10; ++i) {
+    accepted += bucket.tryAcquire(Requests(1));
+  }
+  EXPECT_EQ(accepted, 2);
+}
+
+TEST(TokenBucket, SlowRate) {
+  using Requests = phy::Qty<phy::Radian>;
+  using PerTenSeconds =
+      phy::Qty<phy::details::Frequency, std::ratio<1, 10>>;
+  phy::TokenBucket<Requests, ManualClock> bucket(Requests(2), PerTenSeconds(1));
+
+  EXPECT_TRUE(bucket.tryAcquire(Requests(2)));
+  EXPECT_FALSE(bucket.tryAcquire(Requests(1)));
+
+  ManualClock::nanos += 5000000000; // half of the refill time of a token
+  EXPECT_FALSE(bucket.tryAcquire(Requests(1)));
+  EXPECT_FALSE(bucket.tryAcquire(Requests(3)));
+  ManualClock::nanos += 5000000000;
+  EXPECT_EQ(bucket.available().value, 1);
+  EXPECT_TRUE(bucket.tryAcquire(Requests(1)));
+
+  using PerCentury =
+      phy::Qty<phy::details::Frequency, std::ratio<1, 3155760000>>;
+  EXPECT_THROW((phy::TokenBucket<Requests, ManualClock>(Requests(10),
+                                                        PerCentury(1))),
+               std::invalid_argument);
+}
+
+TEST(TokenBucket, UnevenRate) {
+  using Requests = phy::Qty<phy::Radian>;
+  using PerSecond = phy::Qty<phy::details::Frequency>;
+  phy::TokenBucket<Requests, ManualClock> bucket(Requests(1), PerSecond(3));
+
+  EXPECT_EQ(bucket.available().value, 1);
+  EXPECT_TRUE(bucket.tryAcquire(Requests(1)));
+  EXPECT_FALSE(bucket.tryAcquire(Requests(1)));
+  ManualClock::nanos += 333333333;
+  EXPECT_FALSE(bucket.tryAcquire(Requests(1)));
+  ManualClock::nanos += 1;
+  EXPECT_TRUE(bucket.tryAcquire(Requests(1)));
+
+  for (intmax_t capacity = 1; capacity <= 10; ++capacity) {
+    for (intmax_t rate = 1; rate <= 10; ++rate) {
+      phy::TokenBucket<Requests, ManualClock> full{Requests(capacity),
+                                                   PerSecond(rate)};
+      EXPECT_EQ(full.available().value, capacity);
+      EXPECT_TRUE(full.tryAcquire(Requests(capacity)));
+      EXPECT_FALSE(full.tryAcquire(Requests(1)));
+    }
+  }
+}
+
+TEST(TimerWheel, MixedUnits) {
+  phy::TimerWheel<> wheel; // 1 ms ticks
+  std::vector<int> fired;
+
+  wheel.schedule(phy::Qty<phy::Second>(2), [&fired] { fired.push_back(3); });
+  wheel.schedule(phy::Qty<phy::Second, std::micro>(1500), [&fired] { fired.push_back(1); });
+  auto cancelled = wheel.schedule(phy::Qty<phy::Second, std::milli>(10),
+                                  [&fired] { fired.push_back(-1); });
+  wheel.schedule(phy::Qty<phy::Second, std::ratio<60>>(1), [&fired] { fired.push_back(4); });
+  wheel.scheduleAt(phy::Qty<phy::Second, std::milli>(300), [&fired] { fired.push_back(2); });
+  EXPECT_EQ(wheel.size(), 5u);
+
+  EXPECT_TRUE(wheel.cancel(cancelled));
+  EXPECT_FALSE(wheel.cancel(cancelled));
+
+  EXPECT_EQ(wheel.advance(phy::Qty<phy::Second, std::milli>(1)), 0u);
+  EXPECT_EQ(wheel.advance(phy::Qty<phy::Second, std::milli>(1)), 1u); // 1.5 ms rounded up
+  EXPECT_EQ(wheel.advanceTo(phy::Qty<phy::Second, std::milli>(1999)), 1u);
+  EXPECT_EQ(wheel.advanceTo(phy::Qty<phy::Second>(2)), 1u);
+  EXPECT_EQ(wheel.advanceTo(phy::Qty<phy::Second>(100)), 1u);
+
+  EXPECT_EQ(fired, (std::vector<int>{1, 2, 3, 4}));
+  EXPECT_EQ(wheel.size(), 0u);
+  EXPECT_EQ(wheel.now().value, 100000);
+}
+
+TEST(TimerWheel, CascadeAndReschedule) {
+  phy::TimerWheel<std::milli, 2, 2> wheel; // 4 slots per level, 16 ms span
+  std::vector<intmax_t> fired;
+
+  for (int ms : {3, 5, 16, 17, 40, 100}) {
+    wheel.schedule(phy::Qty<phy::Second, std::milli>(ms),
+                   [&wheel, &fired] { fired.push_back(wheel.now().value); });
+  }
+  wheel.schedule(phy::Qty<phy::Second, std::milli>(7), [&wheel, &fired] {
+    fired.push_back(wheel.now().value);
+    wheel.schedule(phy::Qty<phy::Second, std::milli>(0),
+                   [&wheel, &fired] { fired.push_back(wheel.now().value); });
+  });
+
+  EXPECT_EQ(wheel.advanceTo(phy::Qty<phy::Second>(1)), 8u);
+  EXPECT_EQ(fired, (std::vector<intmax_t>{3, 5, 7, 8, 16, 17, 40, 100}));
+}
+
+TEST(TimerWheel, NegativeTimes) {
+  EXPECT_THROW(phy::TimerWheel<>(phy::Qty<phy::Second>(-1)),
+               std::invalid_argument);
+
+  phy::TimerWheel<> wheel(phy::Qty<phy::Second>(1));
+  EXPECT_EQ(wheel.advanceTo(phy::Qty<phy::Second>(-1)), 0u);
+  EXPECT_EQ(wheel.advance(phy::Qty<phy::Second, std::milli>(-5)), 0u);
+  EXPECT_EQ(wheel.now().value, 1000);
+
+  std::vector<int> fired;
+  wheel.schedule(phy::Qty<phy::Second>(-2), [&fired] { fired.push_back(1); });
+  wheel.scheduleAt(phy::Qty<phy::Second>(-2), [&fired] { fired.push_back(2); });
+  wheel.schedule(phy::Qty<phy::Second, std::milli>(3),
+                 [&fired] { fired.push_back(3); });
+  EXPECT_EQ(wheel.advance(phy::Qty<phy::Second, std::milli>(1)), 2u);
+  EXPECT_EQ(fired.size(), 2u);
+  EXPECT_EQ(wheel.advance(phy::Qty<phy::Second, std::milli>(2)), 1u);
+  EXPECT_EQ(fired.back(), 3);
+}
+
+TEST(RuntimeUnit, Parse) {
+  using namespace phy::details;
+
+  auto kmh = phy::parseUnit("km/h");
+  EXPECT_TRUE(kmh.hasDimension<Speed>());
+  EXPECT_EQ(kmh.num, 5);
+  EXPECT_EQ(kmh.den, 18);
+
+  EXPECT_EQ(phy::parseUnit("m.s-2"), phy::RuntimeUnit::of<Acceleration>());
+  EXPECT_EQ(phy::parseUnit("kg*m^2/s^2"), phy::RuntimeUnit::of<Energy>());
+  EXPECT_EQ(phy::parseUnit("kg"), phy::RuntimeUnit::of<phy::Kilogram>());
+  EXPECT_EQ(phy::parseUnit("min"), (phy::RuntimeUnit::of<phy::Second, std::ratio<60>>()));
+  EXPECT_EQ(phy::parseUnit("KiB"), (phy::RuntimeUnit::of<phy::Bit, phy::Kibibyte::Ratio>()));
+  EXPECT_EQ(phy::parseUnit("mm"), (phy::RuntimeUnit::of<phy::Metre, std::milli>()));
+  EXPECT_THROW(phy::parseUnit("furlong"), std::invalid_argument);
+  EXPECT_EQ(phy::parseUnit("1/s"), phy::RuntimeUnit::of<Frequency>());
+  EXPECT_EQ(phy::parseUnit("1"), phy::RuntimeUnit::of<phy::Radian>());
+  EXPECT_THROW(phy::parseUnit("2/s"), std::invalid_argument);
+  EXPECT_THROW(phy::parseUnit("m/"), std::invalid_argument);
+}
+
+TEST(Csv, ParseScaledOverflow) {
+  EXPECT_EQ(phy::internal::parseScaled("1.5e-20", 1, 1), 0);
+  EXPECT_EQ(phy::internal::parseScaled("-2.5e3", 3, 2), -3750);
+  EXPECT_THROW(phy::internal::parseScaled("9999999999e30", 1, 1),
+               std::out_of_range);
+  EXPECT_THROW(phy::internal::parseScaled("99999999999999999999", INTMAX_MAX,
+                                          1),
+               std::out_of_range);
+  EXPECT_THROW(phy::internal::parseScaled("12abc", 1, 1), std::runtime_error);
+}
+
+TEST(Csv, TypedColumns) {
+  std::string path = ::testing::TempDir() + "units_typed.csv";
+  {
+    std::ofstream out(path);
+    out << "distance[km], duration[ms],speed[km/h]\n";
+    out << "1.5,2000,36\n";
+    out << "0.0125,-3,7.2\r\n";
+    out << "\n";
+    out << "2e-3,1.5e1,0\n";
+  }
+
+  auto columns = phy::readCsv<phy::Qty<phy::Metre>, phy::Qty<phy::Second, std::milli>,
+                              phy::Qty<phy::details::Speed, std::centi>>(path);
+  auto &distance = std::get<0>(columns);
+  auto &duration = std::get<1>(columns);
+  auto &speed = std::get<2>(columns);
+
+  ASSERT_EQ(distance.size(), 3u);
+  EXPECT_EQ(distance[0].value, 1500);
+  EXPECT_EQ(distance[1].value, 12);
+  EXPECT_EQ(distance[2].value, 2);
+  EXPECT_EQ(duration[1].value, -3);
+  EXPECT_EQ(duration[2].value, 15);
+  EXPECT_EQ(speed[0].value, 1000); // 10 m/s
+  EXPECT_EQ(speed[1].value, 200);
+
+  EXPECT_THROW((phy::readCsv<phy::Qty<phy::Second>, phy::Qty<phy::Second>,
+                             phy::Qty<phy::details::Speed>>(path)),
+               std::runtime_error);
+  EXPECT_THROW(phy::readCsv<phy::Qty<phy::Metre>>(path), std::runtime_error);
+}
+
+TEST(Csv, ParallelChunks) {
+  std::string path = ::testing::TempDir() + "units_chunks.csv";
+  {
+    std::ofstream out(path);
+    out << "time[s],size[KiB],label\n";
+    for (int i = 0; i < 10000; ++i) {
+      out << i << ',' << i % 7 << ".5," << i * 2 << '\n';
+    }
+  }
+
+  auto typed = phy::readCsv<phy::Qty<phy::Second, std::milli>, phy::Byte, phy::Qty<phy::Radian>>(path, 4);
+  auto &time = std::get<0>(typed);
+  auto &size = std::get<1>(typed);
+  ASSERT_EQ(time.size(), 10000u);
+  for (int i = 0; i < 10000; ++i) {
+    ASSERT_EQ(time[i].value, i * 1000);
+    ASSERT_EQ(size[i].value, (i % 7) * 1024 + 512);
+  }
+
+  auto columns = phy::readCsvColumns(path, 3);
+  ASSERT_EQ(columns.size(), 3u);
+  EXPECT_EQ(columns[1].name, "size");
+  EXPECT_EQ(columns[1].unit, (phy::RuntimeUnit::of<phy::Bit, phy::Kibibyte::Ratio>()));
+  EXPECT_DOUBLE_EQ(columns[1].values[9], 2.5);
+  EXPECT_DOUBLE_EQ(columns[2].values[9999], 19998.0);
+}
+
+TEST(ColumnFile, MappedZeroCopy) {
+  using Millisecond = phy::Qty<phy::Second, std::milli>;
+  std::string path = ::testing::TempDir() + "units_column.phyq";
+
+  std::vector<Millisecond> timestamps;
+  for (int i = 0; i < 1000; ++i) {
+    timestamps.push_back(Millisecond(i * 3));
+  }
+  phy::writeColumn(path, phy::QtySpan(timestamps));
+
+  phy::MappedColumn<Millisecond> column(path);
+  auto span = column.span();
+  ASSERT_EQ(span.size(), 1000u);
+  EXPECT_EQ(reinterpret_cast<std::uintptr_t>(span.data()) % 64, 0u);
+  EXPECT_EQ(span[999].value, 2997);
+
+  EXPECT_THROW(phy::MappedColumn<phy::Time>{path}, std::runtime_error);
+  EXPECT_THROW(phy::MappedColumn<phy::Length>{path}, std::runtime_error);
+}
+
+TEST(ColumnFile, ConvertedRead) {
+  std::string path = ::testing::TempDir() + "units_column_km.phyq";
+  std::vector<phy::Qty<phy::Metre, std::kilo>> distances{
+      phy::Qty<phy::Metre, std::kilo>(1), phy::Qty<phy::Metre, std::kilo>(-42)};
+  phy::writeColumn(path, phy::QtySpan(distances));
+
+  auto metres = phy::readColumn<phy::Length>(path);
+  ASSERT_EQ(metres.size(), 2u);
+  EXPECT_EQ(metres[0].value, 1000);
+  EXPECT_EQ(metres[1].value, -42000);
+
+  EXPECT_THROW(phy::readColumn<phy::Time>(path), std::runtime_error);
+}
+
+TEST(ColumnFile, ForgedHeaderAndRange) {
+  std::string path = ::testing::TempDir() + "units_column_forged.phyq";
+  std::vector<phy::Qty<phy::Metre, std::kilo>> distances{
+      phy::Qty<phy::Metre, std::kilo>(10000000000000000)};
+  phy::writeColumn(path, phy::QtySpan(distances));
+  EXPECT_THROW(phy::readColumn<phy::Length>(path), std::out_of_range);
+  using Megametre = phy::Qty<phy::Metre, std::mega>;
+  EXPECT_EQ(phy::readColumn<Megametre>(path)[0].value, 10000000000000);
+
+  {
+    std::fstream file(path, std::ios::binary | std::ios::in | std::ios::out);
+    uint64_t count = uint64_t(1) << 61;
+    file.seekp(offsetof(phy::ColumnHeader, count));
+    file.write(reinterpret_cast<const char *>(&count), sizeof(count));
+  }
+  using Kilometre = phy::Qty<phy::Metre, std::kilo>;
+  EXPECT_THROW(phy::MappedColumn<Kilometre>{path}, std::runtime_error);
+
+  {
+    std::fstream file(path, std::ios::binary | std::ios::in | std::ios::out);
+    uint64_t count = 1;
+    uint64_t offset = uint64_t(1) << 62;
+    file.seekp(offsetof(phy::ColumnHeader, count));
+    file.write(reinterpret_cast<const char *>(&count), sizeof(count));
+    file.write(reinterpret_cast<const char *>(&offset), sizeof(offset));
+  }
+  EXPECT_THROW(phy::readColumn<phy::Length>(path), std::runtime_error);
+}
+
+TEST(Arrow, ZeroCopyRoundTrip) {
+  using Kilometre = phy::Qty<phy::Metre, std::kilo>;
+  phy::QtyVector<Kilometre> distances{Kilometre(3), Kilometre(5), Kilometre(8)};
+
+  ArrowSchema schema;
+  ArrowArray array;
+  phy::exportArrowSchema<Kilometre>(&schema, "distance");
+  phy::exportArrowArray(phy::QtySpan(distances), &array);
+  EXPECT_STREQ(schema.format, "l");
+  EXPECT_STREQ(schema.name, "distance");
+  EXPECT_EQ(phy::arrowUnit(schema),
+            (phy::RuntimeUnit::of<phy::Metre, std::kilo>()));
+
+  phy::ArrowColumn<Kilometre> column(&schema, &array);
+  EXPECT_EQ(schema.release, nullptr);
+  EXPECT_EQ(array.release, nullptr);
+  ASSERT_EQ(column.size(), 3u);
+  EXPECT_EQ(column.span().data(), distances.data());
+  EXPECT_EQ(column.span()[2].value, 8);
+}
+
+TEST(Arrow, OwnedColumnAndUnitMismatch) {
+  ArrowSchema schema;
+  ArrowArray array;
+  phy::exportArrowSchema<phy::Time>(&schema);
+  phy::exportArrowArray(phy::QtyVector<phy::Time>{phy::Time(1), phy::Time(2)},
+                        &array);
+  EXPECT_THROW(phy::ArrowColumn<phy::Length>(&schema, &array),
+               std::runtime_error);
+  EXPECT_EQ(array.release, nullptr);
+
+  phy::exportArrowSchema<phy::Time>(&schema);
+  phy::exportArrowArray(phy::QtyVector<phy::Time>{phy::Time(1), phy::Time(2)},
+                        &array);
+  phy::ArrowColumn<phy::Time> column(&schema, &array);
+  EXPECT_EQ(column.span()[1].value, 2);
+}
+
+TEST(Arrow, NullCountNotComputed) {
+  phy::QtyVector<phy::Time> times{phy::Time(1), phy::Time(2), phy::Time(3)};
+  ArrowSchema schema;
+  ArrowArray array;
+  phy::exportArrowSchema<phy::Time>(&schema);
+  phy::exportArrowArray(phy::QtySpan(times), &array);
+  array.null_count = -1;
+  phy::ArrowColumn<phy::Time> column(&schema, &array);
+  EXPECT_EQ(column.span()[2].value, 3);
+
+  uint8_t validity = 0x05; // the second value is null
+  phy::exportArrowSchema<phy::Time>(&schema);
+  phy::exportArrowArray(phy::QtySpan(times), &array);
+  array.null_count = -1;
+  array.buffers[0] = &validity;
+  EXPECT_THROW(phy::ArrowColumn<phy::Time>(&schema, &array),
+               std::runtime_error);
+}
+
+TEST(Json, ReadQuantities) {
+  using KilometrePerHour =
+      phy::Qty<phy::details::Speed, std::ratio<1000, 3600>>;
+  phy::JsonReader reader(R"({
+    "name": "probe", "tags": [1, {"a": "]"}],
+    "speed": {"unit": "km/h", "value": 12.5},
+    "limit": "90 km/h",
+    "samples": ["1.5 m/s", {"value": 3}]
+  })");
+
+  std::vector<phy::RuntimeQuantity> samples;
+  std::string_view key;
+  reader.beginObject();
+  while (reader.nextMember(key)) {
+    if (key == "speed") {
+      using MillimetrePerSecond = phy::Qty<phy::details::Speed, std::milli>;
+      EXPECT_EQ(reader.readQty<MillimetrePerSecond>().value, 3472);
+    } else if (key == "limit") {
+      EXPECT_EQ(reader.readQty<KilometrePerHour>().value, 90);
+    } else if (key == "samples") {
+      reader.beginArray();
+      while (reader.nextElement()) {
+        samples.push_back(reader.readQuantity());
+      }
+    } else {
+      reader.skipValue();
+    }
+  }
+  EXPECT_TRUE(reader.atEnd());
+
+  ASSERT_EQ(samples.size(), 2u);
+  EXPECT_DOUBLE_EQ(samples[0].value, 1.5);
+  EXPECT_TRUE(samples[0].unit.hasDimension<phy::details::Speed>());
+  EXPECT_TRUE(samples[1].unit.hasDimension<phy::Radian>());
+
+  phy::JsonReader wrong(R"("3 s")");
+  EXPECT_THROW(wrong.readQty<phy::Length>(), std::runtime_error);
+}
+
+TEST(Json, WriteQuantities) {
+  std::ostringstream out;
+  phy::JsonWriter writer(out);
+  writer.beginObject();
+  writer.key("distance");
+  writer.quantity(phy::Qty<phy::Metre, std::kilo>(3));
+  writer.key("samples");
+  writer.beginArray();
+  writer.quantity(phy::Qty<phy::Second, std::milli>(250));
+  writer.quantity(phy::RuntimeQuantity{2.0, phy::parseUnit("kW")});
+  writer.endArray();
+  writer.endObject();
+  EXPECT_EQ(out.str(), "{\"distance\":{\"value\":3000,\"unit\":\"m\"},"
+                       "\"samples\":[{\"value\":0.25,\"unit\":\"s\"},"
+                       "{\"value\":2000,\"unit\":\"m2.kg.s-3\"}]}");
+
+  std::string text = out.str();
+  phy::JsonReader reader(text);
+  std::string_view key;
+  reader.beginObject();
+  ASSERT_TRUE(reader.nextMember(key));
+  using Kilometre = phy::Qty<phy::Metre, std::kilo>;
+  using Millisecond = phy::Qty<phy::Second, std::milli>;
+  EXPECT_EQ(reader.readQty<Kilometre>().value, 3);
+  ASSERT_TRUE(reader.nextMember(key));
+  reader.beginArray();
+  ASSERT_TRUE(reader.nextElement());
+  EXPECT_EQ(reader.readQty<Millisecond>().value, 250);
+  ASSERT_TRUE(reader.nextElement());
+  EXPECT_EQ(reader.readQty<phy::Qty<phy::details::Power>>().value, 2000);
+  EXPECT_FALSE(reader.nextElement());
+  EXPECT_FALSE(reader.nextMember(key));
+}
+
+TEST(Json, EscapingAndInvalidNumbers) {
+  std::ostringstream out;
+  phy::JsonWriter writer(out);
+  writer.beginObject();
+  writer.key("a\"b");
+  writer.string("x\\y\n\x01");
+  writer.endObject();
+  EXPECT_EQ(out.str(), "{\"a\\\"b\":\"x\\\\y\\n\\u0001\"}");
+
+  phy::JsonReader invalid(R"(["abc km/h", "12.5 ", "  3 m/s ", 1.2.3])");
+  invalid.beginArray();
+  ASSERT_TRUE(invalid.nextElement());
+  EXPECT_THROW(invalid.readQuantity(), std::runtime_error);
+  ASSERT_TRUE(invalid.nextElement());
+  phy::RuntimeQuantity plain = invalid.readQuantity();
+  EXPECT_DOUBLE_EQ(plain.value, 12.5);
+  EXPECT_EQ(plain.unit, phy::parseUnit("1"));
+  ASSERT_TRUE(invalid.nextElement());
+  EXPECT_EQ(invalid.readQty<phy::Qty<phy::details::Speed>>().value, 3);
+  ASSERT_TRUE(invalid.nextElement());
+  EXPECT_THROW(invalid.readNumber(), std::runtime_error);
+
+  phy::JsonReader truncated(std::string_view("\"ab\\", 4));
+  EXPECT_THROW(truncated.readString(), std::runtime_error);
+
+  for (const char *text : {"01", "1.", "-", "+1", ".5", "1e", "1e+", "-01"}) {
+    phy::JsonReader number(text);
+    EXPECT_THROW(number.readNumber(), std::runtime_error) << text;
+  }
+  phy::JsonReader valid("-0.5e+3");
+  EXPECT_DOUBLE_EQ(valid.readNumber(), -500.0);
+  phy::JsonReader leadingZero(R"("01 m")");
+  EXPECT_THROW(leadingZero.readQty<phy::Length>(), std::runtime_error);
+
+  phy::JsonReader missingComma(R"({"a": 1 "b": 2})");
+  std::string_view key;
+  missingComma.beginObject();
+  ASSERT_TRUE(missingComma.nextMember(key));
+  missingComma.readNumber();
+  EXPECT_THROW(missingComma.nextMember(key), std::runtime_error);
+
+  phy::JsonReader trailingComma("[1, 2,]");
+  trailingComma.beginArray();
+  ASSERT_TRUE(trailingComma.nextElement());
+  trailingComma.readNumber();
+  ASSERT_TRUE(trailingComma.nextElement());
+  trailingComma.readNumber();
+  EXPECT_THROW(trailingComma.nextElement(), std::runtime_error);
+
+  phy::JsonReader leadingComma("[, 1]");
+  leadingComma.beginArray();
+  EXPECT_THROW(leadingComma.nextElement(), std::runtime_error);
+}
+
+TEST(Codec, DeltaOfDeltaTimestamps) {
+  using Nanosecond = phy::Qty<phy::Second, std::nano>;
+  std::vector<Nanosecond> timestamps;
+  intmax_t t = 1700000000000000000;
+  for (int i = 0; i < 1000; ++i) {
+    t += 1000000 + (i % 7) - 3;
+    timestamps.push_back(Nanosecond(t));
+  }
+
+  auto encoded = phy::encodeColumn(phy::QtySpan(timestamps),
+                                   phy::Codec::DeltaOfDelta);
+  EXPECT_LT(encoded.size() * 6, timestamps.size() * sizeof(intmax_t));
+
+  auto decoded = phy::decodeColumn<Nanosecond>(encoded);
+  ASSERT_EQ(decoded.size(), timestamps.size());
+  for (std::size_t i = 0; i < decoded.size(); ++i) {
+    EXPECT_EQ(decoded[i].value, timestamps[i].value);
+  }
+  EXPECT_THROW(phy::decodeColumn<phy::Time>(encoded), std::runtime_error);
+}
+
+TEST(Codec, XorAndExtremes) {
+  std::vector<phy::Length> lengths{
+      phy::Length(INTMAX_MIN), phy::Length(INTMAX_MAX), phy::Length(0),
+      phy::Length(0),          phy::Length(-1),         phy::Length(42)};
+  for (int i = 0; i < 300; ++i) {
+    lengths.push_back(phy::Length(5000 + i / 50));
+  }
+
+  for (auto codec : {phy::Codec::DeltaOfDelta, phy::Codec::Xor}) {
+    auto decoded = phy::decodeColumn<phy::Length>(
+        phy::encodeColumn(phy::QtySpan(lengths), codec));
+    ASSERT_EQ(decoded.size(), lengths.size());
+    for (std::size_t i = 0; i < decoded.size(); ++i) {
+      EXPECT_EQ(decoded[i].value, lengths[i].value);
+    }
+  }
+}
+
+TEST(Codec, MalformedBlocks) {
+  std::vector<phy::Time> times;
+  for (int i = 0; i < 300; ++i) {
+    times.push_back(phy::Time(i * i));
+  }
+  for (phy::Codec codec : {phy::Codec::DeltaOfDelta, phy::Codec::Xor}) {
+    std::vector<uint8_t> data =
+        phy::encodeColumn(phy::QtySpan<phy::Time>(times), codec);
+
+    std::vector<uint8_t> truncated(data.begin(), data.end() - 1);
+    EXPECT_THROW(phy::decodeColumn<phy::Time>(truncated), std::runtime_error);
+    std::vector<uint8_t> header(data.begin(), data.begin() + 40);
+    EXPECT_THROW(phy::decodeColumn<phy::Time>(header), std::runtime_error);
+
+    std::vector<uint8_t> forged = data;
+    uint16_t count = 5000;
+    std::memcpy(forged.data() + offsetof(phy::CodecBlockHeader, count),
+                &count, sizeof(count));
+    EXPECT_THROW(phy::decodeColumn<phy::Time>(forged), std::runtime_error);
+  }
+}
+
+TEST(ZoneMap, SkipsBlocks) {
+  using Millisecond = phy::Qty<phy::Second, std::milli>;
+  std::vector<Millisecond> timestamps;
+  for (int i = 0; i < 1000; ++i) {
+    timestamps.push_back(Millisecond(i * 10 + (i % 3)));
+  }
+  auto encoded =
+      phy::encodeColumn(phy::QtySpan(timestamps), phy::Codec::DeltaOfDelta);
+  phy::CompressedColumn<Millisecond> column(encoded);
+
+  ASSERT_EQ(column.size(), 1000u);
+  ASSERT_EQ(column.blocks().size(), 8u);
+  EXPECT_EQ(column.blocks()[1].row, 128u);
+  EXPECT_EQ(column.blocks()[1].min, 1282);
+  EXPECT_EQ(column.blocks()[7].max, 9990);
+
+  auto lo = phy::Qty<phy::Second>(1);
+  auto hi = phy::Qty<phy::Second, std::ratio<1, 100>>(451);
+  auto expected = phy::where(phy::QtySpan(timestamps), lo, hi);
+  EXPECT_EQ(column.where(lo, hi), expected);
+  EXPECT_EQ(expected.size(), 351u);
+
+  EXPECT_EQ(column.selectBetween(phy::Qty<phy::Second>(10),
+                                 phy::Qty<phy::Second>(20))
+                .count(),
+            0u);
+  EXPECT_EQ(column.selectBetween(phy::Qty<phy::Second>(-1),
+                                 phy::Qty<phy::Second>(20))
+                .count(),
+            1000u);
+}
+
+TEST(ZoneMap, OwnedAndMalformedData) {
+  std::vector<phy::Length> lengths;
+  for (int i = 0; i < 200; ++i) {
+    lengths.push_back(phy::Length(i));
+  }
+  phy::CompressedColumn<phy::Length> column(
+      phy::encodeColumn(phy::QtySpan(lengths), phy::Codec::Xor));
+  EXPECT_EQ(column.where(phy::Length(150), phy::Length(152)),
+            (std::vector<std::size_t>{150, 151}));
+
+  auto encoded = phy::encodeColumn(phy::QtySpan(lengths), phy::Codec::Xor);
+  std::vector<uint8_t> truncated(encoded.begin(), encoded.end() - 1);
+  EXPECT_THROW(phy::CompressedColumn<phy::Length>{truncated},
+               std::runtime_error);
+  uint16_t count = 5000;
+  std::memcpy(encoded.data() + offsetof(phy::CodecBlockHeader, count), &count,
+              sizeof(count));
+  EXPECT_THROW(phy::CompressedColumn<phy::Length>{encoded}, std::runtime_error);
+}
+
+TEST(TimeSeries, AppendAndRange) {
+  using Millisecond = phy::Qty<phy::Second, std::milli>;
+  std::string directory = ::testing::TempDir() + "units_series";
+  std::filesystem::remove_all(directory);
+
+  phy::TimeSeriesWriter<Millisecond, phy::Length, phy::Temperature> writer(
+      directory, 100, 8);
+  phy::TimeSeriesReader<Millisecond, phy::Length, phy::Temperature> reader(
+      directory);
+  EXPECT_EQ(reader.size(), 0u);
+
+  for (int i = 0; i < 250; ++i) {
+    writer.append(Millisecond(i * 10), phy::Length(i), phy::Temperature(-i));
+  }
+  EXPECT_EQ(writer.segments(), 3u);
+  EXPECT_THROW(
+      writer.append(Millisecond(0), phy::Length(0), phy::Temperature(0)),
+      std::invalid_argument);
+
+  reader.refresh();
+  EXPECT_EQ(reader.size(), 250u);
+
+  auto slices = reader.range(phy::Qty<phy::Second, std::centi>(95),
+                             phy::Qty<phy::Second>(2));
+  ASSERT_EQ(slices.size(), 2u);
+  EXPECT_EQ(slices[0].time[0].value, 950);
+  EXPECT_EQ(slices[0].size(), 5u);
+  EXPECT_EQ(slices[1].size(), 100u);
+  EXPECT_EQ(std::get<0>(slices[1].values)[99].value, 199);
+  EXPECT_EQ(std::get<1>(slices[1].values)[0].value, -100);
+
+  writer.append(Millisecond(2500), phy::Length(250), phy::Temperature(0));
+  EXPECT_EQ(reader.size(), 251u);
+}
+
+TEST(TimeSeries, ResumeAndSchema) {
+  using Millisecond = phy::Qty<phy::Second, std::milli>;
+  std::string directory = ::testing::TempDir() + "units_series_resume";
+  std::filesystem::remove_all(directory);
+  {
+    phy::TimeSeriesWriter<Millisecond, phy::Length> writer(directory, 64);
+    writer.append(Millisecond(5), phy::Length(1));
+  }
+  phy::TimeSeriesWriter<Millisecond, phy::Length> writer(directory, 64);
+  EXPECT_THROW(writer.append(Millisecond(4), phy::Length(2)),
+               std::invalid_argument);
+  writer.append(Millisecond(6), phy::Length(2));
+
+  phy::TimeSeriesReader<Millisecond, phy::Length> reader(directory);
+  EXPECT_EQ(reader.size(), 2u);
+  EXPECT_THROW((phy::TimeSeriesReader<Millisecond, phy::Time>(directory)),
+               std::runtime_error);
+}
+
+TEST(TimeSeries, MappedFileKeepsExistingData) {
+  std::string path = ::testing::TempDir() + "units_mapped_file";
+  std::filesystem::remove(path);
+  {
+    phy::MappedFile created(path, 4096);
+    created.writableData()[100] = 42;
+  }
+  EXPECT_THROW(phy::MappedFile(path, std::size_t(16)), std::runtime_error);
+
+  phy::MappedFile reopened(path, phy::MapMode::ReadWrite);
+  ASSERT_EQ(reopened.size(), 4096u);
+  EXPECT_EQ(reopened.data()[100], 42);
+  reopened.writableData()[101] = 43;
+  EXPECT_EQ(phy::MappedFile(path).data()[101], 43);
+}
+
+TEST(TimeSeries, ForgedHeader) {
+  using Millisecond = phy::Qty<phy::Second, std::milli>;
+  using Writer = phy::TimeSeriesWriter<Millisecond, phy::Length>;
+  using Reader = phy::TimeSeriesReader<Millisecond, phy::Length>;
+  std::string directory = ::testing::TempDir() + "units_series_forged";
+  std::filesystem::remove_all(directory);
+  EXPECT_THROW(Writer(directory, 0), std::invalid_argument);
+  EXPECT_THROW(Writer(directory, 64, 0), std::invalid_argument);
+  EXPECT_THROW(Writer(directory, SIZE_MAX / 4), std::invalid_argument);
+  {
+    Writer writer(directory, 64, 1);
+    writer.append(Millisecond(5), phy::Length(1));
+  }
+
+  std::string path = directory + "/segment-000000.phy";
+  auto patch = [&path](std::size_t offset, uint64_t value) {
+    std::fstream file(path, std::ios::binary | std::ios::in | std::ios::out);
+    file.seekp(offset);
+    file.write(reinterpret_cast<const char *>(&value), sizeof(value));
+  };
+  patch(offsetof(phy::SegmentHeader, capacity), uint64_t(1) << 61);
+  EXPECT_THROW(Reader{directory}, std::runtime_error);
+  EXPECT_THROW(Writer(directory, 64, 1), std::runtime_error);
+
+  patch(offsetof(phy::SegmentHeader, capacity), 64);
+  patch(offsetof(phy::SegmentHeader, committed), 65);
+  EXPECT_THROW(Reader{directory}, std::runtime_error);
+
+  patch(offsetof(phy::SegmentHeader, committed), 1);
+  EXPECT_EQ(Reader(directory).size(), 1u);
+}
+
+TEST(SharedRing, ProducersAndConsumer) {
+  std::string name = "/units_ring_" + std::to_string(::getpid());
+  auto consumer = phy::SharedRing<phy::Length>::create(name, 1000);
+  EXPECT_EQ(consumer.capacity(), 1024u);
+  EXPECT_THROW(phy::SharedRing<phy::Time>::attach(name), std::runtime_error);
+
+  const intmax_t count = 100000;
+  auto produce = [&name, count]() {
+    auto producer = phy::SharedRing<phy::Length>::attach(name);
+    for (intmax_t next = 1; next <= count;) {
+      auto span = producer.reserve(8);
+      for (auto &value : span) {
+        value = phy::Length(next++);
+      }
+      producer.commit(span);
+    }
+  };
+  std::thread first(produce);
+  std::thread second(produce);
+
+  intmax_t sum = 0;
+  intmax_t received = 0;
+  while (received < 2 * count) {
+    auto span = consumer.read();
+    for (auto value : span) {
+      sum += value.value;
+    }
+    received += span.size();
+    consumer.release(span.size());
+  }
+  first.join();
+  second.join();
+  phy::SharedRing<phy::Length>::unlink(name);
+
+  EXPECT_EQ(received, 2 * count);
+  EXPECT_EQ(sum, count * (count + 1));
+}
+
+TEST(SharedRing, AttachChecksCapacity) {
+  std::string name = "/units_ring_corrupt_" + std::to_string(::getpid());
+  auto ring = phy::SharedRing<phy::Length>::create(name, 16);
+
+  int fd = ::shm_open(name.c_str(), O_RDWR, 0);
+  ASSERT_GE(fd, 0);
+  void *mapped = ::mmap(nullptr, sizeof(phy::SharedRingHeader),
+                        PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  ::close(fd);
+  ASSERT_NE(mapped, MAP_FAILED);
+  auto header = static_cast<phy::SharedRingHeader *>(mapped);
+
+  for (uint64_t capacity : {uint64_t(0), uint64_t(12), uint64_t(1) << 62}) {
+    header->capacity = capacity;
+    EXPECT_THROW(phy::SharedRing<phy::Length>::attach(name),
+                 std::runtime_error);
+  }
+  header->capacity = 16;
+  EXPECT_EQ(phy::SharedRing<phy::Length>::attach(name).capacity(), 16u);
+
+  ::munmap(mapped, sizeof(phy::SharedRingHeader));
+  phy::SharedRing<phy::Length>::unlink(name);
+}
+
+TEST(SpscQueue, SingleValues) {
+  phy::SpscQueue<phy::Second, std::milli> queue(3);
+  EXPECT_EQ(queue.capacity(), 4u);
+  for (int i = 0; i < 4; ++i) {
+    EXPECT_TRUE(queue.tryPush(phy::Qty<phy::Second>(i)));
+  }
+  EXPECT_FALSE(queue.tryPush(phy::Qty<phy::Second>(4)));
+
+  phy::Qty<phy::Second, std::milli> q(0);
+  ASSERT_TRUE(queue.tryPop(q));
+  EXPECT_EQ(q.value, 0);
+  ASSERT_TRUE(queue.tryPop(q));
+  EXPECT_EQ(q.value, 1000);
+  EXPECT_EQ(queue.front().size(), 2u);
+}
+
+TEST(SpscQueue, Batches) {
+  phy::SpscQueue<phy::Metre> queue(256);
+  const intmax_t count = 200000;
+
+  std::thread producer([&queue, count]() {
+    std::vector<phy::Length> batch;
+    for (intmax_t next = 0; next < count;) {
+      batch.clear();
+      for (int i = 0; i < 100 && next + i < count; ++i) {
+        batch.push_back(phy::Length(next + i));
+      }
+      for (std::size_t pushed = 0; pushed < batch.size();) {
+        pushed += queue.push(phy::QtySpan(batch).subspan(
+            pushed, batch.size() - pushed));
+      }
+      next += batch.size();
+    }
+  });
+
+  intmax_t expected = 0;
+  bool ordered = true;
+  while (expected < count) {
+    auto span = queue.front();
+    for (auto value : span) {
+      ordered &= (value.value == expected++);
+    }
+    queue.pop(span.size());
+  }
+  producer.join();
+  EXPECT_TRUE(ordered);
+}
+
+TEST(Pipeline, TypedStages) {
+  using Millimetre = phy::Qty<phy::Metre, std::milli>;
+  using MillimetreSecond =
+      phy::Qty<phy::MultiReturnUnit<phy::Metre, phy::Second>, std::milli>;
+
+  phy::ThreadPool pool(3);
+  intmax_t sum = 0;
+  std::size_t batches = 0;
+  auto pipeline =
+      phy::PipelineBuilder<phy::Length>(2, pool)
+          .then(phy::stages::convert<Millimetre>())
+          .then(phy::stages::multiply(phy::Qty<phy::Second>(2)))
+          .sink([&sum, &batches](phy::QtySpan<const MillimetreSecond> batch) {
+            for (auto q : batch) {
+              sum += q.value;
+            }
+            ++batches;
+          });
+
+  for (int i = 0; i < 100; ++i) {
+    phy::QtyVector<phy::Length> batch;
+    for (int j = 0; j < 10; ++j) {
+      batch.push_back(phy::Length(i * 10 + j));
+    }
+    pipeline.push(std::move(batch));
+  }
+  pipeline.finish();
+
+  EXPECT_EQ(batches, 100u);
+  EXPECT_EQ(sum, 2000000 * intmax_t(999) * 1000 / 2);
+}
+
+TEST(Pipeline, StageError) {
+  phy::ThreadPool pool(2);
+  auto pipeline =
+      phy::PipelineBuilder<phy::Time>(4, pool)
+          .then([](phy::QtySpan<const phy::Time> batch) {
+            if (batch.size() == 3) {
+              throw std::runtime_error("stage failed");
+            }
+            return phy::QtyVector<phy::Time>(batch.begin(), batch.end());
+          })
+          .sink([](phy::QtySpan<const phy::Time>) {});
+
+  pipeline.push({phy::Time(1)});
+  pipeline.push({phy::Time(1), phy::Time(2), phy::Time(3)});
+  pipeline.push({phy::Time(1)});
+  EXPECT_THROW(pipeline.finish(), std::runtime_error);
+
+  pipeline.push({phy::Time(1)});
+  EXPECT_NO_THROW(pipeline.finish());
+}
+
+TEST(Pipeline, SplitAndDroppedBatches) {
+  phy::ThreadPool pool(3);
+  std::size_t batches = 0;
+  intmax_t sum = 0;
+  auto pipeline =
+      phy::PipelineBuilder<phy::Length>(2, pool)
+          .then([](phy::QtySpan<const phy::Length> batch) {
+            std::vector<phy::QtyVector<phy::Length>> res;
+            for (auto q : batch) {
+              if (q.value % 2 == 0) {
+                res.push_back({q});
+              }
+            }
+            return res;
+          })
+          .then(phy::stages::convert<phy::Length>())
+          .sink([&batches, &sum](phy::QtySpan<const phy::Length> batch) {
+            EXPECT_EQ(batch.size(), 1u);
+            sum += batch.begin()->value;
+            ++batches;
+          });
+
+  std::size_t expectedBatches = 0;
+  intmax_t expectedSum = 0;
+  for (int i = 0; i < 100; ++i) {
+    phy::QtyVector<phy::Length> batch;
+    for (int j = 0; j < i % 5; ++j) {
+      batch.push_back(phy::Length(i * 10 + j));
+      if (j % 2 == 0) {
+        ++expectedBatches;
+        expectedSum += i * 10 + j;
+      }
+    }
+    pipeline.push(std::move(batch));
+  }
+  pipeline.finish();
+
+  EXPECT_EQ(batches, expectedBatches);
+  EXPECT_EQ(sum, expectedSum);
+}
+
+TEST(Parallel, TransformAndReduce) {
+  phy::ThreadPool pool(4);
+  const std::size_t size = 200000;
+  std::vector<phy::Length> distances;
+  std::vector<phy::Time> durations;
+  for (std::size_t i = 0; i < size; ++i) {
+    distances.push_back(phy::Length(i % 1000));
+    durations.push_back(phy::Time(1 + i % 3));
+  }
+
+  auto doubled = phy::parallel::transform(
+      phy::QtySpan(distances),
+      [](phy::Length l) { return l * phy::Qty<phy::Radian>(2); }, pool);
+  ASSERT_EQ(doubled.size(), size);
+  EXPECT_EQ(doubled[999].value, 1998);
+
+  auto speeds = phy::parallel::transform(
+      phy::QtySpan(distances), phy::QtySpan(durations),
+      [](phy::Length l, phy::Time t) { return l / t; }, pool);
+  static_assert(std::is_same<decltype(speeds)::value_type,
+                             phy::Qty<phy::details::Speed>>::value,
+                "the unit of the result is deduced");
+  EXPECT_EQ(speeds[5].value, 5 / 3);
+
+  EXPECT_EQ(phy::parallel::reduce(phy::QtySpan(distances), pool).value,
+            intmax_t(size / 1000) * 999 * 1000 / 2);
+  auto longest = phy::parallel::reduce(
+      phy::QtySpan(distances), phy::Length(0),
+      [](phy::Length a, phy::Length b) { return a.value < b.value ? b : a; },
+      pool);
+  EXPECT_EQ(longest.value, 999);
+
+  std::atomic<intmax_t> count(0);
+  phy::parallel::for_each(
+      phy::QtySpan(durations),
+      [&count](phy::Time t) { count += (t.value == 3); }, pool);
+  EXPECT_EQ(count.load(), intmax_t(size / 3));
+}
+
+TEST(Parallel, InclusiveScanAndNesting) {
+  phy::ThreadPool pool(3);
+  std::vector<phy::Length> steps;
+  for (int i = 0; i < 300000; ++i) {
+    steps.push_back(phy::Length(i % 7 - 2));
+  }
+  auto cumulative = phy::parallel::inclusive_scan(phy::QtySpan(steps), pool);
+  intmax_t sum = 0;
+  bool exact = true;
+  for (std::size_t i = 0; i < steps.size(); ++i) {
+    sum += steps[i].value;
+    exact &= (cumulative[i].value == sum);
+  }
+  EXPECT_TRUE(exact);
+
+  std::atomic<intmax_t> total(0);
+  std::vector<std::thread> callers;
+  for (int i = 0; i < 4; ++i) {
+    callers.emplace_back([&]() {
+      total += phy::parallel::reduce(phy::QtySpan(steps), pool).value;
+    });
+  }
+  for (auto &caller : callers) {
+    caller.join();
+  }
+  EXPECT_EQ(total.load(), 4 * sum);
+}
+
+TEST(Scan, InclusiveAndExclusive) {
+  phy::ThreadPool pool(3);
+  using Millimeter = phy::Qty<phy::Metre, std::milli>;
+  std::vector<Millimeter> steps;
+  for (int i = 0; i < 200003; ++i) {
+    steps.push_back(Millimeter(i % 5 - 1));
+  }
+  phy::QtySpan<Millimeter> span(steps);
+  auto inclusive = phy::inclusive_scan(span, phy::ScanOverflow::Check, pool);
+  auto exclusive =
+      phy::exclusive_scan(span, phy::Length(1), phy::ScanOverflow::Wrap, pool);
+  using Result = decltype(inclusive)::value_type;
+  static_assert(std::is_same<Result, Millimeter>::value,
+                "the ratio of the column is kept");
+
+  intmax_t sum = 0;
+  bool exact = true;
+  for (std::size_t i = 0; i < steps.size(); ++i) {
+    exact &= (exclusive[i].value == 1000 + sum);
+    sum += steps[i].value;
+    exact &= (inclusive[i].value == sum);
+  }
+  EXPECT_TRUE(exact);
+}
+
+TEST(Scan, CheckedOverflow) {
+  std::vector<phy::Length> values(100000, phy::Length(1));
+  values[50000] = phy::Length(INTMAX_MAX - 60000);
+  phy::QtySpan<phy::Length> span(values);
+  EXPECT_THROW(phy::inclusive_scan(span, phy::ScanOverflow::Check),
+               std::overflow_error);
+  auto wrapped = phy::inclusive_scan(span);
+  EXPECT_LT(wrapped.back().value, 0);
+
+  std::vector<phy::Length> fits(values.begin(), values.begin() + 50001);
+  auto checked = phy::inclusive_scan(phy::QtySpan<phy::Length>(fits),
+                                     phy::ScanOverflow::Check);
+  EXPECT_EQ(checked.back().value, INTMAX_MAX - 10000);
+}
+
+TEST(Calculus, IntegratePowerOverIrregularTimes) {
+  using Millisecond = phy::Qty<phy::Second, std::milli>;
+  using Watt = phy::Qty<phy::details::Power>;
+  std::vector<Millisecond> times{Millisecond(0), Millisecond(1000),
+                                 Millisecond(1500), Millisecond(4000)};
+  std::vector<Watt> power{Watt(2), Watt(4), Watt(4), Watt(6)};
+
+  auto energy = phy::integrate(phy::QtySpan<Millisecond>(times),
+                               phy::QtySpan<Watt>(power));
+  using Millijoule = phy::Qty<
+      phy::MultiReturnUnit<phy::details::Power, phy::Second>, std::milli>;
+  static_assert(std::is_same<decltype(energy), Millijoule>::value,
+                "a power integrated over a time is an energy");
+  EXPECT_EQ(energy.value, 17500);
+
+  times[2] = Millisecond(1000);
+  EXPECT_THROW(phy::integrate(phy::QtySpan<Millisecond>(times),
+                              phy::QtySpan<Watt>(power)),
+               std::invalid_argument);
+}
+
+TEST(Calculus, DifferentiateLengthTwice) {
+  std::vector<phy::Time> times;
+  std::vector<phy::Length> positions;
+  for (intmax_t t : {0, 1, 3, 4, 7, 8}) {
+    times.push_back(phy::Time(t));
+    positions.push_back(phy::Length(t * t));
+  }
+  phy::QtySpan<phy::Time> t(times);
+  auto speed = phy::differentiate(t, phy::QtySpan<phy::Length>(positions));
+  auto acceleration = phy::differentiate(t, phy::QtySpan(speed));
+  using Speed = phy::Qty<phy::details::Speed>;
+  using Acceleration = phy::Qty<phy::details::Acceleration>;
+  static_assert(std::is_same<decltype(speed)::value_type, Speed>::value,
+                "a length derived over a time is a speed");
+  static_assert(
+      std::is_same<decltype(acceleration)::value_type, Acceleration>::value,
+      "a speed derived over a time is an acceleration");
+
+  EXPECT_EQ(speed.front().value, 1);
+  for (std::size_t i = 1; i + 1 < times.size(); ++i) {
+    EXPECT_EQ(speed[i].value, 2 * times[i].value);
+  }
+  EXPECT_EQ(speed.back().value, 15);
+  EXPECT_EQ(acceleration[2].value, 2);
+  EXPECT_EQ(acceleration[3].value, 2);
+
+  std::vector<phy::Time> uneven{phy::Time(0), phy::Time(2), phy::Time(3)};
+  std::vector<phy::Length> walk{phy::Length(0), phy::Length(1), phy::Length(3)};
+  using MillimetrePerSecond = phy::Qty<phy::details::Speed, std::milli>;
+  auto fine = phy::differentiate<MillimetrePerSecond>(
+      phy::QtySpan<phy::Time>(uneven), phy::QtySpan<phy::Length>(walk));
+  EXPECT_EQ(fine[0].value, 500);
+  EXPECT_EQ(fine[1].value, 1500);
+  EXPECT_EQ(fine[2].value, 2000);
+}